@@ -14,9 +14,12 @@
 
 #include "OSAL.h"
 #include "OSAL_Clock.h"
+#include "OSAL_HrTimer.h"
+#include "OSAL_Memory.h"
 
 #include "SEGGER_SYSVIEW_Conf.h"
 #include "SEGGER_SYSVIEW.h"
+#include "SEGGER_RTT.h"
 
 /*********************************************************************
  * MACROS
@@ -24,6 +27,17 @@
 
 #define TICK_IN_MS            1 /* 1 millisecond */ 
 
+/* TIM2 counts microseconds for osal_get_time_us() and the high-resolution timers. Its
+   interrupt edits the timer list and runs callbacks, so it takes the most urgent priority
+   that HAL_ENTER_CRITICAL_SECTION() still masks through BASEPRI */
+#define HRTIMER_IRQ_PRIO      (OSAL_IRQ_MAX_INTERRUPT_PRIORITY >> (8 - __NVIC_PRIO_BITS))
+
+#if ( OSALMEM_TRACE )
+/* RTT up channel for the binary heap allocation trace, SystemView uses channel 1 */
+#define MEMTRACE_RTT_CHANNEL  2
+#define MEMTRACE_RTT_BUFSZ    (OSALMEM_TRACE_CNT * sizeof(osalMemTraceRec_t))
+#endif
+
 #if defined(_NO_PRINTF)
 #define UART_TIMEOUT_VALUE    1000
 #ifdef __GNUC__
@@ -44,6 +58,21 @@ extern HAL_TickFreqTypeDef uwTickFreq;  /* 1KHz */
 
 extern UART_HandleTypeDef huart1;
 
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+#if ( OSALMEM_TRACE )
+static uint8_t memTraceRttBuf[MEMTRACE_RTT_BUFSZ];
+#endif
+
+/* Upper half of the microsecond counter, TIM2 is 16 bits wide */
+static volatile uint16_t hrTimerHigh;
+
+/* Compare point of the first high-resolution timer */
+static volatile uint32_t hrTimerCompare;
+static volatile uint8_t  hrTimerArmed;
+
 /*********************************************************************
  * EXTERN FUNCTIONS
  */
@@ -133,12 +162,124 @@ void HAL_IncTick(void)
 
   uwTick += uwTickFreq;
 
-  /* Update OSAL timer and clock */
-  osalAdjustTimer(TICK_IN_MS);
+  /* Count the tick, the OSAL loop updates the timers and clock */
+  osalTickIncrement(TICK_IN_MS);
 
   SEGGER_SYSVIEW_RecordExitISR();
 }
 
+/***************************************************************************************************
+ * @fn      hrTimerInit
+ *
+ * @brief   Run TIM2 at 1 MHz, its update interrupt extends the counter to 32 bits
+ *
+ * @param   None
+ *
+ * @return  None
+ ***************************************************************************************************/
+static void hrTimerInit(void)
+{
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+  /* The APB1 timers run at twice PCLK1 when APB1 is divided */
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+  {
+    clk *= 2;
+  }
+
+  __HAL_RCC_TIM2_CLK_ENABLE();
+
+  TIM2->CR1 = 0;
+  TIM2->PSC = (clk / 1000000) - 1;
+  TIM2->ARR = 0xFFFF;
+  TIM2->EGR = TIM_EGR_UG;    /* Load the prescaler */
+  TIM2->SR = 0;
+  TIM2->DIER = TIM_DIER_UIE;
+
+  NVIC_SetPriority(TIM2_IRQn, HRTIMER_IRQ_PRIO);
+  NVIC_EnableIRQ(TIM2_IRQn);
+
+  TIM2->CR1 = TIM_CR1_CEN;
+}
+
+/***************************************************************************************************
+ * @fn      hrTimerArm
+ *
+ * @brief   Program channel 1 for the compare point once it falls in the current 16-bit
+ *          period of TIM2, the update interrupt re-arms for later periods. A compare point
+ *          that has already passed raises the interrupt at once. Ints must be disabled.
+ *
+ * @param   None
+ *
+ * @return  None
+ ***************************************************************************************************/
+static void hrTimerArm(void)
+{
+  uint32_t now = OSAL_UsCounter_Hook();
+
+  if (!hrTimerArmed)
+  {
+    TIM2->DIER &= ~TIM_DIER_CC1IE;
+  }
+  else if ((int32_t)(now - hrTimerCompare) >= 0)
+  {
+    TIM2->DIER |= TIM_DIER_CC1IE;
+    TIM2->EGR = TIM_EGR_CC1G;
+  }
+  else if ((now >> 16) == (hrTimerCompare >> 16))
+  {
+    TIM2->CCR1 = (uint16_t)hrTimerCompare;
+    TIM2->SR = ~TIM_SR_CC1IF;
+    TIM2->DIER |= TIM_DIER_CC1IE;
+
+    /* The counter may have passed the compare value while it was written */
+    if ((int32_t)(OSAL_UsCounter_Hook() - hrTimerCompare) >= 0)
+    {
+      TIM2->EGR = TIM_EGR_CC1G;
+    }
+  }
+  else
+  {
+    TIM2->DIER &= ~TIM_DIER_CC1IE;
+  }
+}
+
+/***************************************************************************************************
+ * @fn      TIM2_IRQHandler
+ *
+ * @brief   Microsecond counter overflow and high-resolution timer compare
+ *
+ * @param   None
+ *
+ * @return  None
+ ***************************************************************************************************/
+void TIM2_IRQHandler(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+
+  if (TIM2->SR & TIM_SR_UIF)
+  {
+    TIM2->SR = ~TIM_SR_UIF;
+    hrTimerHigh++;
+    hrTimerArm();
+  }
+
+  if ((TIM2->SR & TIM_SR_CC1IF) && (TIM2->DIER & TIM_DIER_CC1IE))
+  {
+    TIM2->SR = ~TIM_SR_CC1IF;
+    TIM2->DIER &= ~TIM_DIER_CC1IE;
+    hrTimerArmed = 0;
+
+    __set_PRIMASK(primask);
+    osal_hr_timer_isr();
+    return;
+  }
+
+  __set_PRIMASK(primask);
+}
+
 /***************************************************************************************************
  * @fn      OSAL_Init_Hook
  *
@@ -153,7 +294,149 @@ void OSAL_Init_Hook(void)
 
   SEGGER_SYSVIEW_Conf();            /* Configure and initialize SystemView  */
 
+  /* Start the DWT cycle counter behind OSAL_Timestamp_Hook() */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  /* Start the microsecond counter behind OSAL_UsCounter_Hook() */
+  hrTimerInit();
+
+#if ( OSALMEM_TRACE )
+  /* Records are written whole or not at all, so the host never sees a torn record */
+  SEGGER_RTT_ConfigUpBuffer(MEMTRACE_RTT_CHANNEL, "OSALHeap", memTraceRttBuf,
+                            sizeof(memTraceRttBuf), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+}
+
+/***************************************************************************************************
+ * @fn      OSAL_Timestamp_Hook
+ *
+ * @brief   Free running timestamp used to measure short intervals
+ *
+ * @param   None
+ *
+ * @return  DWT cycle counter, SystemCoreClock counts per second
+ ***************************************************************************************************/
+uint32_t OSAL_Timestamp_Hook(void)
+{
+  return DWT->CYCCNT;
+}
+
+/***************************************************************************************************
+ * @fn      OSAL_Context_Hook
+ *
+ * @brief   Id of the execution context - handlers of the same preemption priority never
+ *          preempt each other, so they share an id
+ *
+ * @param   None
+ *
+ * @return  0 in thread mode, 1 + preemption priority in a handler, 0xFF in NMI and HardFault
+ ***************************************************************************************************/
+uint8_t OSAL_Context_Hook(void)
+{
+  uint32_t ipsr = __get_IPSR();
+  uint32_t preempt, sub;
+
+  if (ipsr == 0)
+  {
+    return 0;
+  }
+
+  /* NMI and HardFault have fixed priorities above all others */
+  if (ipsr < 4)
+  {
+    return 0xFF;
+  }
+
+  NVIC_DecodePriority(NVIC_GetPriority((IRQn_Type)((int32_t)ipsr - 16)),
+                      NVIC_GetPriorityGrouping(), &preempt, &sub);
+
+  return (uint8_t)(preempt + 1);
+}
+
+/***************************************************************************************************
+ * @fn      OSAL_UsCounter_Hook
+ *
+ * @brief   Free running microsecond counter - TIM2 extended by its overflow count
+ *
+ * @param   None
+ *
+ * @return  Microseconds, wrapping at 32 bits
+ ***************************************************************************************************/
+uint32_t OSAL_UsCounter_Hook(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t high;
+  uint32_t low;
+
+  __disable_irq();
+
+  high = hrTimerHigh;
+  low = TIM2->CNT;
+
+  /* Count an overflow the interrupt has not seen yet */
+  if ((TIM2->SR & TIM_SR_UIF) && (low < 0x8000))
+  {
+    high++;
+  }
+
+  __set_PRIMASK(primask);
+
+  return (high << 16) | low;
+}
+
+/***************************************************************************************************
+ * @fn      OSAL_UsCompare_Hook
+ *
+ * @brief   Arm the TIM2 compare interrupt for the first high-resolution timer
+ *
+ * @param   expire - microsecond counter value to interrupt at
+ *
+ * @return  None
+ ***************************************************************************************************/
+void OSAL_UsCompare_Hook(uint32_t expire)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+
+  hrTimerCompare = expire;
+  hrTimerArmed = 1;
+  hrTimerArm();
+
+  __set_PRIMASK(primask);
+}
+
+#if ( OSALMEM_TRACE )
+/***************************************************************************************************
+ * @fn      memTraceRttOut
+ *
+ * @brief   Heap allocation trace sink writing to the RTT up channel
+ *
+ * @param   buf - trace record
+ * @param   len - size of the trace record
+ *
+ * @return  Number of bytes written, 0 if the channel is full
+ ***************************************************************************************************/
+static uint16_t memTraceRttOut(const void *buf, uint16_t len)
+{
+  return (uint16_t)SEGGER_RTT_Write(MEMTRACE_RTT_CHANNEL, buf, len);
+}
+
+/***************************************************************************************************
+ * @fn      OSAL_MemTrace_Hook
+ *
+ * @brief   Drain the heap allocation trace to RTT, called while OSAL is idle
+ *
+ * @param   None
+ *
+ * @return  None
+ ***************************************************************************************************/
+void OSAL_MemTrace_Hook(void)
+{
+  (void)osal_mem_trace_drain(memTraceRttOut);
 }
+#endif
 
 #if defined(_NO_PRINTF)
 /**
@@ -14,10 +14,11 @@
 static void Periodic_Event(void)
 {
 //------------------------------- time test ------------------------------------
-    static int32_t oldtime = 0, new_time = 0, deviation = 0;
+    static uint32_t oldtime = 0, new_time = 0;
+    static int32_t deviation = 0;
 
     new_time = osal_GetSystemClock();
-    deviation = ABS((new_time - oldtime) - SBP_PERIODIC_EVT_DELAY);
+    deviation = ABS(OSAL_TIME_DIFF(new_time, oldtime) - SBP_PERIODIC_EVT_DELAY);
     oldtime = new_time;
     printf("deviation  = %d ms\r\n", deviation);
 //------------------------------- nv test --------------------------------------
@@ -50,10 +51,11 @@ static void Periodic_Event(void)
 }
 
 void cb_timer_test(uint8_t* pData){
-        static int32_t oldtime1 = 0, new_time1 = 0, deviation1 = 0;
+        static uint32_t oldtime1 = 0, new_time1 = 0;
+        static int32_t deviation1 = 0;
         
         new_time1 = osal_GetSystemClock();
-        deviation1 = ABS((new_time1 - oldtime1) - SBP_CBTIMER_EVT_DELAY);
+        deviation1 = ABS(OSAL_TIME_DIFF(new_time1, oldtime1) - SBP_CBTIMER_EVT_DELAY);
         oldtime1 = new_time1;
         printf("cb timer %s\r\n", pData);
         printf("deviation1 = %d ms\r\n", deviation1);
@@ -35,6 +35,8 @@ Purpose : Initializes and handles the hardware for embOS
 #include <BSP.h>
 #include <OSAL.h>
 #include <OSAL_Clock.h>
+#include <OSAL_HrTimer.h>
+#include <OSAL_Memory.h>
 
 /*********************************************************************
 *
@@ -45,6 +47,8 @@ Purpose : Initializes and handles the hardware for embOS
 
 #define TICK_IN_MS 1 /* 1 millisecond */ 
 
+#define MEMTRACE_FILE "OSAL_MemTrace.bin"  /* Binary heap allocation trace */
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -57,6 +61,17 @@ Purpose : Initializes and handles the hardware for embOS
 */
 static  LARGE_INTEGER TampStart;
 static  LARGE_INTEGER TampFreq;
+#if ( OSALMEM_TRACE )
+static  FILE*         MemTraceFile;
+#endif
+static  CRITICAL_SECTION HeapLock;
+static  INIT_ONCE     HeapLockOnce = INIT_ONCE_STATIC_INIT;
+static  LONG          ContextCnt;
+static  __declspec(thread) uint8_t Context;  /* Context id + 1, 0 until assigned */
+static  HANDLE        HrTimerEvent;          /* Wakes the high-resolution timer thread */
+static  volatile LONG HrTimerArmed;
+static  volatile uint32_t HrTimerCompare;
+static  HANDLE        hMainThread;           /* OSAL thread, held while the "interrupt" runs */
 
 /*********************************************************************
 *
@@ -99,11 +114,11 @@ static void _ISRTickThread(void) {
       tDiff = tDiffMax;
     }
     //
-    // Execute the actual ISR one time for every ms
+    // Execute the actual ISR - only counts the ticks, the OSAL loop
+    // applies them to the clock and timers
     //
-
-    while (tDiff-- > 0) {
-      osalAdjustTimer(TICK_IN_MS);
+    if (tDiff > 0) {
+      osalTickIncrement((uint32_t)tDiff * TICK_IN_MS);
     }
 
     //
@@ -127,6 +142,61 @@ static void APIENTRY _voidAPC(DWORD Dummy) {
   OS_USEPARA(Dummy);
 }
 
+/*********************************************************************
+*
+*       _HrTimerInterrupt()
+*
+*  Function description
+*    Runs the compare interrupt of the high-resolution timers the way
+*    the target would: the OSAL thread is held while it runs. The heap
+*    lock, which also guards the active list, is taken first so that
+*    the OSAL thread is never held inside a heap or list update.
+*/
+static void _HrTimerInterrupt(void) {
+  CONTEXT ThreadContext;
+
+  OSAL_HeapLock_Hook();
+  SuspendThread(hMainThread);
+  //
+  // SuspendThread() is asynchronous, reading the context waits until
+  // the thread has actually stopped
+  //
+  ThreadContext.ContextFlags = CONTEXT_CONTROL;
+  GetThreadContext(hMainThread, &ThreadContext);
+  osal_hr_timer_isr();
+  ResumeThread(hMainThread);
+  OSAL_HeapUnlock_Hook();
+}
+
+/*********************************************************************
+*
+*       _HrTimerThread()
+*
+*  Function description
+*    Stands in for the compare interrupt of the high-resolution
+*    timers. It waits on HrTimerEvent while the compare point is more
+*    than 2 ms away, as Windows waits are only millisecond accurate,
+*    and polls the microsecond counter for the rest.
+*/
+static void _HrTimerThread(void) {
+  int32_t Remaining;
+
+  while (1) {
+    if (HrTimerArmed == 0) {
+      WaitForSingleObject(HrTimerEvent, INFINITE);
+      continue;
+    }
+    Remaining = (int32_t)(HrTimerCompare - OSAL_UsCounter_Hook());
+    if (Remaining > 2000) {
+      WaitForSingleObject(HrTimerEvent, (DWORD)(Remaining - 1000) / 1000);
+    } else if (Remaining > 0) {
+      YieldProcessor();
+    } else if (InterlockedExchange(&HrTimerArmed, 0) != 0) {
+      _HrTimerInterrupt();
+    }
+  }
+}
+
 /*********************************************************************
 *
 *       _CbSignalTickProc()
@@ -183,6 +253,14 @@ void OS_InitHW(void) {
   hISRThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) _ISRTickThread, NULL, 0, NULL);
 
   timeSetEvent(1,0, _CbSignalTickProc, (int)hISRThread, (TIME_PERIODIC | TIME_CALLBACK_FUNCTION));
+  //
+  // Start the compare "interrupt" of the high-resolution timers, it
+  // holds the calling thread, which goes on to run OSAL
+  //
+  DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &hMainThread,
+                  0, FALSE, DUPLICATE_SAME_ACCESS);
+  HrTimerEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+  CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) _HrTimerThread, NULL, 0, NULL);
 }
 
 /*********************************************************************
@@ -249,4 +327,136 @@ OS_U32 GetMicrosecondTamp(void)
     return (OS_U32)((count_end.QuadPart - TampStart.QuadPart) / (TampFreq.QuadPart / 1000000.0));
 }
 
+/*********************************************************************
+*
+*       OSAL_Timestamp_Hook()
+*
+*  Function description
+*    Free running timestamp used to measure short intervals, in
+*    performance counter counts.
+*/
+uint32_t OSAL_Timestamp_Hook(void) {
+  LARGE_INTEGER count;
+
+  QueryPerformanceCounter(&count);
+  return (uint32_t)count.QuadPart;
+}
+
+/*********************************************************************
+*
+*       OSAL_UsCounter_Hook()
+*
+*  Function description
+*    Free running microsecond counter, from the performance counter.
+*/
+uint32_t OSAL_UsCounter_Hook(void) {
+  LARGE_INTEGER count;
+  LONGLONG      Ticks;
+
+  QueryPerformanceCounter(&count);
+  Ticks = count.QuadPart - TampStart.QuadPart;
+  //
+  // Split the conversion so that Ticks * 1000000 cannot overflow
+  //
+  return (uint32_t)((Ticks / TampFreq.QuadPart) * 1000000
+                  + ((Ticks % TampFreq.QuadPart) * 1000000) / TampFreq.QuadPart);
+}
+
+/*********************************************************************
+*
+*       OSAL_UsCompare_Hook()
+*
+*  Function description
+*    Arms the high-resolution timer thread for the given counter value.
+*/
+void OSAL_UsCompare_Hook(uint32_t expire) {
+  HrTimerCompare = expire;
+  InterlockedExchange(&HrTimerArmed, 1);
+  SetEvent(HrTimerEvent);
+}
+
+/*********************************************************************
+*
+*       _HeapLockInit()
+*/
+static BOOL CALLBACK _HeapLockInit(PINIT_ONCE pOnce, PVOID pPara, PVOID* ppContext) {
+  OS_USEPARA(pOnce);
+  OS_USEPARA(pPara);
+  OS_USEPARA(ppContext);
+  InitializeCriticalSection(&HeapLock);
+  return TRUE;
+}
+
+/*********************************************************************
+*
+*       OSAL_HeapLock_Hook()
+*
+*  Function description
+*    Locks the OSAL heap. Holding off interrupts is a no-op on the
+*    host, where OSAL may be used from several threads.
+*/
+void OSAL_HeapLock_Hook(void) {
+  InitOnceExecuteOnce(&HeapLockOnce, _HeapLockInit, NULL, NULL);
+  EnterCriticalSection(&HeapLock);
+}
+
+/*********************************************************************
+*
+*       OSAL_HeapUnlock_Hook()
+*/
+void OSAL_HeapUnlock_Hook(void) {
+  LeaveCriticalSection(&HeapLock);
+}
+
+/*********************************************************************
+*
+*       OSAL_Context_Hook()
+*
+*  Function description
+*    Id of the execution context - every thread gets its own id in
+*    the order the threads first ask for it.
+*/
+uint8_t OSAL_Context_Hook(void) {
+  LONG Id;
+
+  if (Context == 0) {
+    Id = InterlockedIncrement(&ContextCnt);
+    Context = (Id < 0xFF) ? (uint8_t)Id : 0xFF;
+  }
+  return (uint8_t)(Context - 1);
+}
+
+#if ( OSALMEM_TRACE )
+/*********************************************************************
+*
+*       _MemTraceFileOut()
+*
+*  Function description
+*    Heap allocation trace sink appending the records to MEMTRACE_FILE.
+*/
+static uint16_t _MemTraceFileOut(const void* pBuf, uint16_t NumBytes) {
+  if (MemTraceFile == NULL) {
+    MemTraceFile = fopen(MEMTRACE_FILE, "wb");
+    if (MemTraceFile == NULL) {
+      return 0;
+    }
+  }
+  return (uint16_t)fwrite(pBuf, 1, NumBytes, MemTraceFile);
+}
+
+/*********************************************************************
+*
+*       OSAL_MemTrace_Hook()
+*
+*  Function description
+*    Drains the heap allocation trace to MEMTRACE_FILE, called while
+*    OSAL is idle.
+*/
+void OSAL_MemTrace_Hook(void) {
+  if (osal_mem_trace_drain(_MemTraceFileOut) != 0) {
+    fflush(MemTraceFile);
+  }
+}
+#endif
+
 /*************************** End of file ****************************/
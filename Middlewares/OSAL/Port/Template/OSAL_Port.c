@@ -12,6 +12,8 @@
 
 #include "OSAL.h"
 #include "OSAL_Clock.h"
+#include "OSAL_Memory.h"
+#include "OSAL_Timers.h"
 
 /*********************************************************************
  * MACROS
@@ -122,3 +124,80 @@ void OSAL_Init_Hook(void)
 {
 
 }
+
+/***************************************************************************************************
+ * @fn      OSAL_Timestamp_Hook
+ *
+ * @brief   Free running timestamp used to measure short intervals, e.g. a CPU cycle counter
+ *
+ * @param   None
+ *
+ * @return  Current timestamp, wrapping at 32 bits
+ ***************************************************************************************************/
+uint32_t OSAL_Timestamp_Hook(void)
+{
+  return 0;
+}
+
+/***************************************************************************************************
+ * @fn      OSAL_Context_Hook
+ *
+ * @brief   Id of the execution context. Contexts that may preempt each other, e.g. the task
+ *          level and interrupts of different priorities, must return distinct ids; an id of
+ *          OSALMEM_CTX_CNT or above opts the context out of the heap block caches.
+ *
+ * @param   None
+ *
+ * @return  Context id, 0 for the task level
+ ***************************************************************************************************/
+uint8_t OSAL_Context_Hook(void)
+{
+  return 0;
+}
+
+/***************************************************************************************************
+ * @fn      OSAL_UsCounter_Hook
+ *
+ * @brief   Free running microsecond counter behind osal_get_time_us() and the high-resolution
+ *          timers, e.g. a timer clocked at 1 MHz. Without one, the OSAL clock is used.
+ *
+ * @param   None
+ *
+ * @return  Microseconds, wrapping at 32 bits
+ ***************************************************************************************************/
+uint32_t OSAL_UsCounter_Hook(void)
+{
+  return osal_GetSystemClock() * 1000;
+}
+
+/***************************************************************************************************
+ * @fn      OSAL_UsCompare_Hook
+ *
+ * @brief   Arm the compare interrupt for the first high-resolution timer. The interrupt calls
+ *          osal_hr_timer_isr() once OSAL_UsCounter_Hook() reaches 'expire', at once if it
+ *          already has. Arming again replaces the previous compare point.
+ *
+ * @param   expire - microsecond counter value to interrupt at
+ *
+ * @return  None
+ ***************************************************************************************************/
+void OSAL_UsCompare_Hook(uint32_t expire)
+{
+  (void)expire;
+}
+
+#if ( OSALMEM_TRACE )
+/***************************************************************************************************
+ * @fn      OSAL_MemTrace_Hook
+ *
+ * @brief   Hook to drain the heap allocation trace, called while OSAL is idle
+ *
+ * @param   None
+ *
+ * @return  None
+ ***************************************************************************************************/
+void OSAL_MemTrace_Hook(void)
+{
+
+}
+#endif
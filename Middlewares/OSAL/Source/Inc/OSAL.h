@@ -22,6 +22,10 @@ extern "C"
  */
 #include "OSAL_Comdef.h"
 
+#if ( OSAL_MSG_COMPACT )
+  #include "OSAL_Memory.h"
+#endif
+
 /*********************************************************************
  * MACROS
  */
@@ -31,15 +35,38 @@ extern "C"
   #define osal_offsetof(type, member) ((uint32_t) &(((type *) 0)->member))
 #endif
 
+// Compact message header: the next link is a 16-bit heap offset and the length
+// is the usable size of the heap block. That is at least the allocated length,
+// but may exceed it by the alignment rounding plus a tail too small to split
+// off, up to OSALMEM_MIN_BLKSZ-1 bytes. Do not enable it when OSAL_MSG_LEN()
+// must be exact.
+#if !defined ( OSAL_MSG_COMPACT )
+  #define OSAL_MSG_COMPACT  FALSE
+#endif
+
+#if ( OSAL_MSG_COMPACT )
+#define OSAL_MSG_NEXT(msg_ptr)      osal_mem_ptr( ((osal_msg_hdr_t *) (msg_ptr) - 1)->next )
+
+#define OSAL_MSG_SET_NEXT(msg_ptr, next_ptr) \
+  (((osal_msg_hdr_t *) (msg_ptr) - 1)->next = osal_mem_offset( next_ptr ))
+#else
 #define OSAL_MSG_NEXT(msg_ptr)      ((osal_msg_hdr_t *) (msg_ptr) - 1)->next
 
+#define OSAL_MSG_SET_NEXT(msg_ptr, next_ptr) \
+  (OSAL_MSG_NEXT( msg_ptr ) = (next_ptr))
+#endif
+
 #define OSAL_MSG_Q_INIT(q_ptr)      *(q_ptr) = NULL
 
 #define OSAL_MSG_Q_EMPTY(q_ptr)     (*(q_ptr) == NULL)
 
 #define OSAL_MSG_Q_HEAD(q_ptr)      (*(q_ptr))
 
+#if ( OSAL_MSG_COMPACT )
+#define OSAL_MSG_LEN(msg_ptr)       (osal_mem_size( (osal_msg_hdr_t *) (msg_ptr) - 1 ) - sizeof( osal_msg_hdr_t ))
+#else
 #define OSAL_MSG_LEN(msg_ptr)       ((osal_msg_hdr_t *) (msg_ptr) - 1)->len
+#endif
 
 #define OSAL_MSG_ID(msg_ptr)        ((osal_msg_hdr_t *) (msg_ptr) - 1)->dest_id
 
@@ -54,12 +81,20 @@ extern "C"
  * TYPEDEFS
  */
 
+#if ( OSAL_MSG_COMPACT )
+typedef struct
+{
+  uint16_t next;     // Heap offset of the next message, 0 at the end of the queue.
+  uint8_t  dest_id;
+} osal_msg_hdr_t;
+#else
 typedef struct
 {
   void   *next;
   uint16_t len;
   uint8_t  dest_id;
 } osal_msg_hdr_t;
+#endif
 
 typedef struct
 {
@@ -71,8 +106,7 @@ typedef void * osal_msg_q_t;
 
 typedef struct mutex_struct
 {
- uint32_t mutex_value;
- struct mutex_struct *next_mutex;
+ uint64_t mutex_expire;   // osal_GetSystemClock64() at which the lease ends, 0 when released
 }osal_mutex_t;
 
 /*********************************************************************
@@ -202,6 +236,11 @@ typedef struct mutex_struct
 
 /*** Mutex Management ***/
 
+  /*
+   * Initialization for the OSAL mutexes.
+   */
+  void osalMutexInit(void);
+
   /*
    * Task Message Allocation
    */
@@ -222,10 +261,6 @@ typedef struct mutex_struct
    * Task Message Allocation
    */
   void osalMutexRelease(osal_mutex_t** mutex);
-  /*
-   * Task Message Allocation
-   */
-  void osalMutexUpdate( uint32_t mutexTime );
 
 /*** Message Management ***/
 
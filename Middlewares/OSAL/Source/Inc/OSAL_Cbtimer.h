@@ -1,9 +1,11 @@
 /******************************************************************************
-  Filename:       OSAL_Clock.h
+  Filename:       OSAL_Cbtimer.h
   Revised:        $Date: 2012-02-02 12:55:32 -0800 (Thu, 02 Feb 2012) $
   Revision:       $Revision: 29143 $
 
-  Description:    OSAL Clock definition and manipulation functions.
+  Description:    OSAL callback timers. The callbacks are kept in the OSAL timer
+                  records and dispatched by a single task, the number of callback
+                  timers is only limited by the timer pool (OSAL_TIMERS_MAX).
 ******************************************************************************/
 #ifndef OSAL_CBTIMER_H
 #define OSAL_CBTIMER_H
@@ -16,15 +18,13 @@ extern "C"
 /*********************************************************************
  * INCLUDES
  */
+#include "OSAL_Timers.h"
 
 /*********************************************************************
  * CONSTANTS
  */
 // Invalid timer id
-#define INVALID_TIMER_ID                           0xFF
-
-// Timed out timer
-#define TIMEOUT_TIMER_ID                           0xFE
+#define INVALID_TIMER_ID                           OSAL_TIMER_NO_HANDLE
 
 /*********************************************************************
  * VARIABLES
@@ -37,10 +37,8 @@ extern "C"
   #error Callback Timer module shouldn't be included (no callback timer is needed)!
 #elif ( OSAL_CBTIMER_NUM_TASKS == 1 )
   #define OSAL_CBTIMER_PROCESS_EVENT( a )          ( a )
-#elif ( OSAL_CBTIMER_NUM_TASKS == 2 )
-  #define OSAL_CBTIMER_PROCESS_EVENT( a )          ( a ), ( a )
 #else
-  #error Maximum of 2 callback timer tasks are supported! Modify it here.
+  #error All callback timers are dispatched by one task, set OSAL_CBTIMER_NUM_TASKS to 1!
 #endif
 
 /*********************************************************************
@@ -52,7 +50,7 @@ extern "C"
 //
 // pData - pointer to data registered with timer
 //
-typedef void (*pfnCbTimer_t)( uint8_t *pData );
+typedef pfnTimerCback_t pfnCbTimer_t;
 
 /*********************************************************************
  * VARIABLES
@@ -76,29 +74,29 @@ extern uint16_t osal_CbTimerProcessEvent( uint8_t  taskId,
 /*
  * Function to start a timer to expire in n mSecs.
  */
-extern Status_t osal_CbTimerStart( pfnCbTimer_t  pfnCbTimer,
-                                   uint8_t        *pData,
-                                   uint32_t        timeout,
-                                   uint8_t        *pTimerId );
+extern Status_t osal_CbTimerStart( pfnCbTimer_t       pfnCbTimer,
+                                   uint8_t           *pData,
+                                   uint32_t           timeout,
+                                   osalTimerHandle_t *pTimerId );
 
 /*
  * Function to start a timer to expire in n mSecs, then reload.
  */
-extern Status_t osal_CbTimerStartReload( pfnCbTimer_t  pfnCbTimer,
-                                         uint8_t        *pData,
-                                         uint32_t        timeout,
-                                         uint8_t        *pTimerId );
+extern Status_t osal_CbTimerStartReload( pfnCbTimer_t       pfnCbTimer,
+                                         uint8_t           *pData,
+                                         uint32_t           timeout,
+                                         osalTimerHandle_t *pTimerId );
 
 /*
  * Function to update a timer that has already been started.
  */
-extern Status_t osal_CbTimerUpdate( uint8_t  timerId,
-                                    uint32_t timeout );
+extern Status_t osal_CbTimerUpdate( osalTimerHandle_t timerId,
+                                    uint32_t          timeout );
 
 /*
  * Function to stop a timer that has already been started.
  */
-extern Status_t osal_CbTimerStop( uint8_t timerId );
+extern Status_t osal_CbTimerStop( osalTimerHandle_t timerId );
 
 /*********************************************************************
 *********************************************************************/
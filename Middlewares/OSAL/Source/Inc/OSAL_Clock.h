@@ -28,6 +28,9 @@ extern "C"
  * CONSTANTS
  */
 
+// Length of an ISO-8601 timestamp written by osal_FormatUTCTime()
+#define OSAL_UTC_ISO8601_LEN  20
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -76,6 +79,16 @@ typedef struct
    */
   extern UTCTime osal_getClock( void );
 
+  /*
+   * Read the free running microsecond counter, wraps at 32 bits.
+   */
+  extern uint32_t osal_get_time_us( void );
+
+  /*
+   * Read the microsecond counter extended to 64 bits, does not wrap.
+   */
+  extern uint64_t osal_get_time_us64( void );
+
     /*
    * Converts UTCTime to UTCTimeStruct
    *
@@ -92,12 +105,50 @@ typedef struct
    */
   extern UTCTime osal_ConvertUTCSecs( UTCTimeStruct *tm );
 
+  /*
+   * Writes UTCTime as an ISO-8601 timestamp, "YYYY-MM-DDThh:mm:ssZ"
+   *
+   * pBuf - buffer of at least OSAL_UTC_ISO8601_LEN + 1 characters
+   */
+  extern uint8_t osal_FormatUTCTime( char *pBuf, UTCTime secTime );
+
   /*
    * Update/Adjust the osal clock and timers
    * Msec - elapsed time in milli seconds 
    */
   extern void osalAdjustTimer( uint32_t Msec );
 
+  /*
+   * Count elapsed milliseconds - called from the tick interrupt
+   * Msec - elapsed time in milli seconds
+   */
+  extern void osalTickIncrement( uint32_t Msec );
+
+  /*
+   * Apply the counted milliseconds to the osal clock and timers
+   */
+  extern void osalTickProcess( void );
+
+  /*
+   * Check for counted milliseconds that are not applied yet
+   */
+  extern uint8_t osalTickPending( void );
+
+  /*
+   * Read the milliseconds counted by the tick interrupt
+   */
+  extern uint32_t osalTickCount( void );
+
+  /*
+   * Read the counted milliseconds that are not applied yet
+   */
+  extern uint32_t osalTickLag( void );
+
+  /*
+   * Longest OSAL tick interrupt work, in OSAL_Timestamp_Hook() units
+   */
+  extern uint32_t osal_tick_isr_max( void );
+
 /*********************************************************************
 *********************************************************************/
 
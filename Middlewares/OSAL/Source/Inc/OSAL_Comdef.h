@@ -372,6 +372,8 @@ typedef             uint32_t  halDataAlign_t;
 #define NV_ITEM_UNINIT            0x09
 #define NV_OPER_FAILED            0x0A
 #define NV_BAD_ITEM_LEN           0x0B
+#define OSAL_SYNC_PENDING         0x0C
+#define OSAL_SYNC_TIMEOUT         0x0D
 
 /*********************************************************************
  * TYPEDEFS
@@ -422,6 +424,14 @@ typedef                        char *_va_list;
 #define ABS(n)     (((n) < 0) ? -(n) : (n))
 #endif
 
+// Wrap-safe comparison of two 32-bit times of the same clock, valid while
+// they lie less than half the clock range apart
+#define OSAL_TIME_DIFF(a,b)       ((int32_t)((uint32_t)(a) - (uint32_t)(b)))
+#define OSAL_TIME_AFTER(a,b)      (OSAL_TIME_DIFF(a,b) > 0)
+#define OSAL_TIME_AFTER_EQ(a,b)   (OSAL_TIME_DIFF(a,b) >= 0)
+#define OSAL_TIME_BEFORE(a,b)     OSAL_TIME_AFTER(b,a)
+#define OSAL_TIME_BEFORE_EQ(a,b)  OSAL_TIME_AFTER_EQ(b,a)
+
 #if !defined(BSET)
 //#define BSET(a,b) (a |= 1 << b)
 #define BSET(VAR,Place)         ( (VAR) |= (uint8_t)((uint8_t)1<<(uint8_t)(Place)) )
@@ -535,9 +545,11 @@ typedef                        char *_va_list;
 #define HAL_ASSERT_SIZE(x,y) typedef char x ## _assert_size_t[-1+10*(sizeof(x) == (y))]
 
 #if defined(DEBUG) || defined(_DEBUG)
-#define HAL_ASSERT(expr)                  st( if (!( expr )) {printf("Assertion failed: %s (%s: %s: %u)\n", #expr, __FILE__, __FUNCTION__, __LINE__); while (1){}} )
-#define HAL_ASSERT_FORCED()               st( {printf("Assertion failed: %s: %s: %u\n", __FILE__, __FUNCTION__, __LINE__); while (1){}} )
-#define HAL_PANIC(expr)                   st( {printf("panic: %s (%s: %s: %u)\n", #expr, __FILE__, __FUNCTION__, __LINE__); while (1){}} )
+/* Report through the OSAL printf (OSAL_Printf.h) without renaming printf here */
+int printf_(const char* format, ...);
+#define HAL_ASSERT(expr)                  st( if (!( expr )) {printf_("Assertion failed: %s (%s: %s: %u)\n", #expr, __FILE__, __FUNCTION__, __LINE__); while (1){}} )
+#define HAL_ASSERT_FORCED()               st( {printf_("Assertion failed: %s: %s: %u\n", __FILE__, __FUNCTION__, __LINE__); while (1){}} )
+#define HAL_PANIC(expr)                   st( {printf_("panic: %s (%s: %s: %u)\n", #expr, __FILE__, __FUNCTION__, __LINE__); while (1){}} )
 #else
 #define HAL_ASSERT(expr)
 #define HAL_ASSERT_FORCED()
@@ -552,6 +564,15 @@ typedef                        char *_va_list;
  * FUNCTIONS
  */
 extern void OSAL_Init_Hook(void);
+extern void OSAL_MemTrace_Hook(void);
+extern uint32_t OSAL_Timestamp_Hook(void);
+extern uint8_t OSAL_Context_Hook(void);
+extern uint32_t OSAL_UsCounter_Hook(void);
+extern void OSAL_UsCompare_Hook(uint32_t expire);
+#ifdef _WIN32
+extern void OSAL_HeapLock_Hook(void);
+extern void OSAL_HeapUnlock_Hook(void);
+#endif
 extern void SysTickIntDisable(void);
 extern void SysTickIntEnable(void);
 
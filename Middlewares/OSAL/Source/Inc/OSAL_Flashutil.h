@@ -25,10 +25,6 @@
  * MACROS
  */
 
-#define ZCD_NV_NWKKEY                     0x0082
-#define ZCD_NV_NWK_ACTIVE_KEY_INFO        0x003A
-#define ZCD_NV_NWK_ALTERN_KEY_INFO        0x003B
-
 // Flash consists of 256 pages of 2 KB.
 #define HAL_FLASH_PAGE_SIZE               2048
 #define HAL_FLASH_WORD_SIZE               8
@@ -0,0 +1,88 @@
+/**************************************************************************************************
+  Filename:       OSAL_HrTimer.h
+  Revised:        $Date$
+  Revision:       $Revision$
+
+  Description:    This module defines the OSAL high-resolution one-shot timers. They run
+                  off the microsecond counter of the port and a compare interrupt,
+                  independent of the millisecond tick, and call their callback from that
+                  interrupt.
+**************************************************************************************************/
+
+#ifndef OSAL_HRTIMER_H
+#define OSAL_HRTIMER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Longest high-resolution timeout, in microseconds
+#define OSAL_HRTIMER_MAX_TIMEOUT    0x7FFFFFFFUL
+
+/*********************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// High-resolution timer callback, called in interrupt context
+typedef void (*pfnHrTimerCback_t)( void *pData );
+
+// High-resolution timer, owned by the caller and linked into the
+// active list while it runs
+typedef struct osalHrTimer
+{
+  struct osalHrTimer *next;     // Next active timer, by expiration time
+  uint32_t            expire;   // Expiration time on the microsecond counter
+  pfnHrTimerCback_t   pfnCback; // Callback function
+  void               *pData;    // Data passed to the callback
+} osalHrTimer_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+  /*
+   * Start or restart a high-resolution one-shot timer.
+   */
+  extern uint8_t osal_hr_timer_start( osalHrTimer_t *pTimer, uint32_t timeout_us,
+                                      pfnHrTimerCback_t pfnCback, void *pData );
+
+  /*
+   * Stop a high-resolution timer.
+   */
+  extern uint8_t osal_hr_timer_stop( osalHrTimer_t *pTimer );
+
+  /*
+   * Latest callback seen so far, in microseconds after the expiration time.
+   */
+  extern uint32_t osal_hr_timer_max_late( void );
+
+  /*
+   * Expire the due timers - called by the port from the compare interrupt.
+   */
+  extern void osal_hr_timer_isr( void );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSAL_HRTIMER_H */
@@ -26,6 +26,89 @@ extern "C"
   #define OSALMEM_METRICS  TRUE
 #endif
 
+// For information about memory profiling, refer to SWRA204 "Heap Memory Management", section 1.5.
+#if !defined ( OSALMEM_PROFILER )
+  #define OSALMEM_PROFILER  TRUE  // Enable/disable the memory usage profiling buckets.
+#endif
+
+// Number of memory usage profiling buckets.
+#define OSALMEM_PROMAX      8
+
+// Binary allocation trace: every alloc/free is recorded in a RAM ring.
+#if !defined ( OSALMEM_TRACE )
+  #define OSALMEM_TRACE  FALSE
+#endif
+
+// Number of records in the trace ring, must be a power of 2.
+#if !defined ( OSALMEM_TRACE_CNT )
+  #define OSALMEM_TRACE_CNT  64
+#endif
+
+// Trace record operations
+#define OSALMEM_TRACE_ALLOC   0x01
+#define OSALMEM_TRACE_FREE    0x02
+#define OSALMEM_TRACE_REALLOC 0x03  // Resized in place, a move is traced as alloc and free
+
+// Trace record offset of a failed allocation
+#define OSALMEM_TRACE_NOBLK   0xFFFF
+
+// Interrupt-off statistics: every heap critical section is timed with
+// OSAL_Timestamp_Hook() and the worst case is kept, see osal_mem_cs_stats().
+#if !defined ( OSALMEM_CS_STATS )
+  #define OSALMEM_CS_STATS  FALSE
+#endif
+
+// Movable allocations: osal_mem_halloc() returns a handle instead of a pointer,
+// and osal_run_system() slides unlocked handle blocks together while idle.
+#if !defined ( OSALMEM_HANDLES )
+  #define OSALMEM_HANDLES  FALSE
+#endif
+
+// Number of handles, at most 255.
+#if !defined ( OSALMEM_HANDLE_CNT )
+  #define OSALMEM_HANDLE_CNT  16
+#endif
+
+// Blocks moved by osal_run_system() each time all tasks are idle.
+#if !defined ( OSALMEM_COMPACT_MOVES )
+  #define OSALMEM_COMPACT_MOVES  1
+#endif
+
+// Invalid handle
+#define OSALMEM_NO_HANDLE     0
+
+// Per-context caches of small blocks in front of the shared heap, see
+// OSAL_Context_Hook(). Cached blocks stay allocated in the heap metrics.
+#if !defined ( OSALMEM_CTX_CACHE )
+  #define OSALMEM_CTX_CACHE  FALSE
+#endif
+
+// Number of contexts with a cache, other contexts use the shared heap directly.
+#if !defined ( OSALMEM_CTX_CNT )
+  #define OSALMEM_CTX_CNT  2
+#endif
+
+// Blocks a context caches per block size.
+#if !defined ( OSALMEM_CACHE_DEPTH )
+  #define OSALMEM_CACHE_DEPTH  4
+#endif
+
+// Blocks moved between a cache and the shared heap under one lock.
+#if !defined ( OSALMEM_CACHE_BATCH )
+  #define OSALMEM_CACHE_BATCH  2
+#endif
+
+// Size of the scratch arena that osal_run_system() resets after every task
+// event dispatch, 0 to disable.
+#if !defined ( OSAL_TASK_ARENA_SIZE )
+  #define OSAL_TASK_ARENA_SIZE  0
+#endif
+
+// Version of the osal_mem_snapshot() format.
+#define OSALMEM_SNAP_VERSION  1
+// Size of the osal_mem_snapshot() header.
+#define OSALMEM_SNAP_HDRSZ    6
+
 /*********************************************************************
  * MACROS
  */
@@ -35,13 +118,137 @@ extern "C"
 #define OSALMEM_IN_USE             0x8000
 // #define DPRINTF_OSALHEAPTRACE   1
 
+// Lock of the shared heap. On target it holds off interrupts; on the host,
+// where that is a no-op and OSAL may run on several threads, the port
+// supplies a real lock.
+#if !defined ( OSALMEM_HEAP_LOCK )
+  #if defined ( _WIN32 )
+    #define OSALMEM_HEAP_LOCK(x)    st( (x) = 0; OSAL_HeapLock_Hook(); )
+    #define OSALMEM_HEAP_UNLOCK(x)  st( (void)(x); OSAL_HeapUnlock_Hook(); )
+  #else
+    #define OSALMEM_HEAP_LOCK(x)    HAL_ENTER_CRITICAL_SECTION(x)
+    #define OSALMEM_HEAP_UNLOCK(x)  HAL_EXIT_CRITICAL_SECTION(x)
+  #endif
+#endif
+
+// Heap functions take the call site (__FILE__, __LINE__) for tracing.
+#if defined ( DPRINTF_OSALHEAPTRACE ) || ( OSALMEM_TRACE )
+  #define OSALMEM_CALL_SITE        TRUE
+#else
+  #define OSALMEM_CALL_SITE        FALSE
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
 
+#if ( OSALMEM_METRICS )
+typedef struct
+{
+  uint16_t blkMax;   // Max cnt of all blocks ever seen at once.
+  uint16_t blkCnt;   // Current cnt of all blocks.
+  uint16_t blkFree;  // Current cnt of free blocks.
+  uint16_t memAlo;   // Current total memory allocated.
+  uint16_t memMax;   // Max total memory ever allocated at once.
+#if ( OSALMEM_PROFILER )
+  uint16_t proCnt[OSALMEM_PROMAX];    // Upper block size of each profiling bucket.
+  uint16_t proCur[OSALMEM_PROMAX+1];  // Current cnt of blocks in each bucket.
+  uint16_t proMax[OSALMEM_PROMAX+1];  // Max cnt of blocks ever seen at once in each bucket.
+  uint16_t proTot[OSALMEM_PROMAX+1];  // Total cnt of allocations from each bucket.
+  uint16_t proSmallBlkMiss;           // Small blocks allocated outside the small-block bucket.
+#endif
+} osalMemMetrics_t;
+#endif
+
+#if ( OSALMEM_TRACE )
+// Binary allocation trace record - 16 bytes, little endian on the target.
+typedef struct
+{
+  uint32_t time;    // osal_GetSystemClock() when the event was recorded.
+  uint32_t file;    // Address of the call site's __FILE__ string.
+  uint16_t line;    // Call site's __LINE__.
+  uint16_t size;    // Requested bytes for an alloc/realloc, block bytes for a free.
+  uint16_t offset;  // Block header offset in the heap, OSALMEM_TRACE_NOBLK on failure.
+  uint8_t  op;      // OSALMEM_TRACE_xxx operation.
+  uint8_t  task;    // Active task ID, TASK_NO_TASK outside of a task.
+} osalMemTraceRec_t;
+
+// Trace sink - returns the number of bytes accepted, 0 if it is full.
+typedef uint16_t (*osalMemTraceOut_t)( const void *buf, uint16_t len );
+#endif
+
+#if ( OSALMEM_CS_STATS )
+typedef struct
+{
+  uint32_t csMax;     // Longest interrupt-off section, in OSAL_Timestamp_Hook() units.
+  uint16_t stepMax;   // Most block headers examined in one interrupt-off section.
+  uint16_t restarts;  // Searches restarted because the heap changed while ints were enabled.
+  uint16_t locked;    // Searches finished with ints held off after too many restarts.
+} osalMemCsStats_t;
+#endif
+
+#if ( OSALMEM_HANDLES )
+// Handle of a movable allocation, OSALMEM_NO_HANDLE if none.
+typedef uint8_t osalMemHandle_t;
+
+typedef struct
+{
+  uint32_t bytesMoved;  // Bytes copied by the moves.
+  uint16_t passes;      // Completed compaction passes over the heap.
+  uint16_t moves;       // Blocks moved.
+  uint8_t  fragBefore;  // 'fragAfter' of the pass before the last one.
+  uint8_t  fragAfter;   // osal_mem_frag() 'fragPct' of the blocks left behind by the last completed pass.
+} osalMemCompactStats_t;
+#endif
+
+#if ( OSALMEM_CTX_CACHE )
+typedef struct
+{
+  uint32_t hits;     // Allocations served from the cache.
+  uint16_t refills;  // Batched allocations from the shared heap.
+  uint16_t flushes;  // Batched returns to the shared heap.
+  uint16_t cached;   // Blocks currently held by the cache.
+} osalMemCacheStats_t;
+#endif
+
+// Scoped arena - a heap region handed out by bump allocation and released
+// all at once by osal_arena_reset(). Not interrupt safe: an arena must only
+// be used from the context that owns it.
+typedef struct
+{
+  uint8_t *base;   // Region carved from the heap.
+  uint16_t size;   // Size of the region in bytes.
+  uint16_t used;   // Bytes handed out since the last reset.
+  uint16_t peak;   // Highest 'used' ever seen.
+  uint16_t fail;   // Allocations that did not fit.
+} osalArena_t;
+
+// One heap block as reported by osal_mem_walk().
+typedef struct
+{
+  uint16_t offset;  // Offset of the block header from the start of the heap.
+  uint16_t len;     // Total block size, including the header, in bytes.
+  uint16_t gen;     // Heap layout generation the block was read in.
+  uint8_t  inUse;   // TRUE if the block is allocated.
+} osalMemBlk_t;
+
+// Fragmentation indices as reported by osal_mem_frag().
+typedef struct
+{
+  uint16_t freeMem;   // Total bytes in free blocks, including their headers.
+  uint16_t freeRuns;  // Number of runs of adjacent free blocks.
+  uint16_t maxRun;    // Size of the largest run of adjacent free blocks.
+  uint8_t  fragPct;   // External fragmentation: 100 * (1 - maxRun / freeMem).
+} osalMemFrag_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
+
+#if ( OSAL_TASK_ARENA_SIZE > 0 )
+// Scratch arena for the task being dispatched, see osal_arena_alloc().
+extern osalArena_t osal_task_arena;
+#endif
  
 /*********************************************************************
  * FUNCTIONS
@@ -60,22 +267,52 @@ extern "C"
  /*
   * Allocate a block of memory.
   */
-#ifdef DPRINTF_OSALHEAPTRACE
+#if ( OSALMEM_CALL_SITE )
   void *osal_mem_alloc_dbg( uint16_t size, const char *fname, unsigned lnum );
 #define osal_mem_alloc(_size ) osal_mem_alloc_dbg(_size, __FILE__, __LINE__)
-#else /* DPRINTF_OSALHEAPTRACE */
+#else /* OSALMEM_CALL_SITE */
   void *osal_mem_alloc( uint16_t size );
-#endif /* DPRINTF_OSALHEAPTRACE */
+#endif /* OSALMEM_CALL_SITE */
 
  /*
   * Free a block of memory.
   */
-#ifdef DPRINTF_OSALHEAPTRACE
+#if ( OSALMEM_CALL_SITE )
   void osal_mem_free_dbg( void *ptr, const char *fname, unsigned lnum );
 #define osal_mem_free(_ptr ) osal_mem_free_dbg(_ptr, __FILE__, __LINE__)
-#else /* DPRINTF_OSALHEAPTRACE */
+#else /* OSALMEM_CALL_SITE */
   void osal_mem_free( void *ptr );
-#endif /* DPRINTF_OSALHEAPTRACE */
+#endif /* OSALMEM_CALL_SITE */
+
+ /*
+  * Resize a block of memory, in place when possible.
+  */
+#if ( OSALMEM_CALL_SITE )
+  void *osal_mem_realloc_dbg( void *ptr, uint16_t size, const char *fname, unsigned lnum );
+#define osal_mem_realloc(_ptr, _size ) osal_mem_realloc_dbg(_ptr, _size, __FILE__, __LINE__)
+#else /* OSALMEM_CALL_SITE */
+  void *osal_mem_realloc( void *ptr, uint16_t size );
+#endif /* OSALMEM_CALL_SITE */
+
+ /*
+  * Carve an arena region from the heap.
+  */
+  uint8_t osal_arena_init( osalArena_t *arena, uint16_t size );
+
+ /*
+  * Allocate from an arena.
+  */
+  void *osal_arena_alloc( osalArena_t *arena, uint16_t size );
+
+ /*
+  * Release everything allocated from an arena.
+  */
+  void osal_arena_reset( osalArena_t *arena );
+
+ /*
+  * Return an arena region to the heap.
+  */
+  void osal_arena_destroy( osalArena_t *arena );
 
 #if ( OSALMEM_METRICS )
  /*
@@ -104,6 +341,117 @@ extern "C"
    */
   uint16_t osal_heap_high_water( void );
 
+#if ( OSALMEM_METRICS )
+  /*
+   * Copy all heap metrics and profiling counters.
+   */
+  void osal_mem_metrics( osalMemMetrics_t *metrics );
+#endif
+
+  /*
+   * Report the heap block following 'blk' - clear 'blk->len' to start.
+   * Stops with 'blk->len' cleared if blocks were split or merged meanwhile.
+   */
+  uint8_t osal_mem_walk( osalMemBlk_t *blk );
+
+  /*
+   * Compute the heap fragmentation indices.
+   */
+  void osal_mem_frag( osalMemFrag_t *frag );
+
+  /*
+   * Return the number of usable bytes of an allocated block.
+   */
+  uint16_t osal_mem_size( void *ptr );
+
+  /*
+   * Convert a heap pointer to its 16-bit offset in the heap, 0 for NULL.
+   */
+  uint16_t osal_mem_offset( void *ptr );
+
+  /*
+   * Convert an offset from osal_mem_offset() back to a pointer.
+   */
+  void *osal_mem_ptr( uint16_t offset );
+
+  /*
+   * Write a binary snapshot of the heap layout.
+   */
+  uint16_t osal_mem_snapshot( uint8_t *buf, uint16_t len );
+
+#if ( OSALMEM_CTX_CACHE )
+  /*
+   * Copy the statistics of a context's block cache.
+   */
+  uint8_t osal_mem_cache_stats( uint8_t ctx, osalMemCacheStats_t *stats );
+
+  /*
+   * Return the blocks cached by the calling context to the shared heap.
+   */
+  void osal_mem_cache_flush( void );
+#endif
+
+#if ( OSALMEM_HANDLES )
+  /*
+   * Allocate a movable block and return its handle.
+   */
+  osalMemHandle_t osal_mem_halloc( uint16_t size );
+
+  /*
+   * Pin a movable block and return its current address.
+   */
+  void *osal_mem_lock( osalMemHandle_t handle );
+
+  /*
+   * Release a pin taken by osal_mem_lock() - pointers to the block become invalid.
+   */
+  void osal_mem_unlock( osalMemHandle_t handle );
+
+  /*
+   * Free a movable block and its handle.
+   */
+  void osal_mem_hfree( osalMemHandle_t handle );
+
+  /*
+   * Incrementally compact the heap by sliding unlocked movable blocks down.
+   */
+  uint8_t osal_mem_compact( uint8_t maxMoves );
+
+  /*
+   * Copy the heap compaction statistics.
+   */
+  void osal_mem_compact_stats( osalMemCompactStats_t *stats );
+#endif
+
+#if ( OSALMEM_CS_STATS )
+  /*
+   * Copy the interrupt-off statistics of the heap.
+   */
+  void osal_mem_cs_stats( osalMemCsStats_t *stats );
+
+  /*
+   * Clear the interrupt-off statistics of the heap.
+   */
+  void osal_mem_cs_reset( void );
+#endif
+
+#if ( OSALMEM_TRACE )
+  /*
+   * Copy and consume the oldest records of the allocation trace ring.
+   */
+  uint16_t osal_mem_trace_read( osalMemTraceRec_t *buf, uint16_t cnt );
+
+  /*
+   * Feed the allocation trace ring to a sink until it is empty or the sink is full.
+   */
+  uint16_t osal_mem_trace_drain( osalMemTraceOut_t out );
+
+  /*
+   * Return the number of trace records overwritten before they were read.
+   */
+  uint16_t osal_mem_trace_lost( void );
+#endif
+
 /*********************************************************************
 *********************************************************************/
 
@@ -30,6 +30,14 @@ extern "C"
  * TYPEDEFS
  */
 
+// Statistics of the cache of the most used NV items
+typedef struct
+{
+  uint32_t hits;       // Lookups served from the cache
+  uint32_t misses;     // Lookups that had to find the item
+  uint32_t evictions;  // Cached items replaced by another one
+} osalNvCacheStats_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -68,6 +76,31 @@ extern uint16_t osal_nv_item_len( uint16_t id );
  */
 extern uint8_t osal_nv_delete( uint16_t id, uint16_t len );
 
+/*
+ * Open an NV transaction.
+ */
+extern uint8_t osal_nv_txn_begin( void );
+
+/*
+ * Stage a write of an NV item in the open transaction.
+ */
+extern uint8_t osal_nv_txn_write( uint16_t id, uint16_t offset, uint16_t len, void *buf );
+
+/*
+ * Write all the items staged by the open transaction, or none of them.
+ */
+extern uint8_t osal_nv_txn_commit( void );
+
+/*
+ * Drop the open transaction.
+ */
+extern void osal_nv_txn_abort( void );
+
+/*
+ * Get the statistics of the NV item cache.
+ */
+extern void osal_nv_cache_stats( osalNvCacheStats_t *stats );
+
 /*********************************************************************
 *********************************************************************/
 
@@ -98,6 +98,11 @@ extern pwrmgr_attribute_t pwrmgr_attribute;
    */
   extern void osal_pwrmgr_powerconserve( void );
 
+  /*
+   * Number of sleeps timed to end with an OSAL timer.
+   */
+  extern uint32_t osal_pwrmgr_wakeups( void );
+
 /*********************************************************************
 *********************************************************************/
 
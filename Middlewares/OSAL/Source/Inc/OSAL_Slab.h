@@ -0,0 +1,116 @@
+/**************************************************************************************************
+  Filename:       OSAL_Slab.h
+  Revised:        $Date$
+  Revision:       $Revision$
+
+  Description:    This module defines the OSAL fixed-size object caches (slabs). A slab
+                  hands out objects of one size from a statically reserved pool with a
+                  free list, so allocation and de-allocation are O(1) and do not fragment
+                  the OSAL heap.
+**************************************************************************************************/
+
+#ifndef OSAL_SLAB_H
+#define OSAL_SLAB_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Slab option flags
+#define OSAL_SLAB_HEAP_FALLBACK     0x01  // Take objects from the heap when the pool is exhausted
+
+/*********************************************************************
+ * MACROS
+ */
+
+// Size of one object in a slab pool - rounded up to halDataAlign_t and large
+// enough to hold the free list link.
+#define OSAL_SLAB_OBJ_SIZE( type ) \
+  ((((sizeof( type ) > sizeof( void * )) ? sizeof( type ) : sizeof( void * )) + \
+    sizeof( halDataAlign_t ) - 1) / sizeof( halDataAlign_t ) * sizeof( halDataAlign_t ))
+
+// Declare the storage for a pool of 'cnt' objects of 'type'.
+#define OSAL_SLAB_POOL( name, type, cnt ) \
+  halDataAlign_t name[(OSAL_SLAB_OBJ_SIZE( type ) * (cnt)) / sizeof( halDataAlign_t )]
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct osalSlab
+{
+  struct osalSlab *next;  // Next registered slab
+  const char *name;       // Name for diagnostics
+  void     *freeList;     // Free objects in the pool
+  uint8_t  *pool;         // Start of the object pool
+  uint16_t  objSize;      // Size of one object in bytes
+  uint16_t  objCnt;       // Number of objects in the pool
+  uint16_t  used;         // Objects currently allocated (pool and heap)
+  uint16_t  maxUsed;      // Highest number of objects ever allocated at once
+  uint16_t  heapCnt;      // Objects currently taken from the heap
+  uint16_t  failCnt;      // Failed allocations
+  uint8_t   flags;        // OSAL_SLAB_xxx option flags
+} osalSlab_t;
+
+typedef struct
+{
+  const char *name;
+  uint16_t objSize;
+  uint16_t objCnt;
+  uint16_t used;
+  uint16_t maxUsed;
+  uint16_t heapCnt;
+  uint16_t failCnt;
+} osalSlabStats_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+  /*
+   * Initialize a slab over a statically reserved pool and register it.
+   */
+  extern void osal_slab_init( osalSlab_t *slab, const char *name, void *pool,
+                              uint16_t objSize, uint16_t objCnt, uint8_t flags );
+
+  /*
+   * Allocate an object from a slab.
+   */
+  extern void *osal_slab_alloc( osalSlab_t *slab );
+
+  /*
+   * Return an object to its slab.
+   */
+  extern void osal_slab_free( osalSlab_t *slab, void *obj );
+
+  /*
+   * Copy the usage statistics of a slab.
+   */
+  extern void osal_slab_stats( osalSlab_t *slab, osalSlabStats_t *stats );
+
+  /*
+   * Iterate over the registered slabs - pass NULL to get the first one.
+   */
+  extern osalSlab_t *osal_slab_next( osalSlab_t *slab );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSAL_SLAB_H */
@@ -0,0 +1,135 @@
+/**************************************************************************************************
+  Filename:       OSAL_Sync.h
+  Revised:        $Date$
+  Revision:       $Revision$
+
+  Description:    This module defines the OSAL counting semaphores and event groups. A task
+                  that cannot take a semaphore or whose event group condition is not met is
+                  queued as a waiter, and the event it names is raised once the semaphore is
+                  handed to it, the condition is met or its timeout elapses. Tasks never
+                  poll or arm retry timers.
+**************************************************************************************************/
+
+#ifndef OSAL_SYNC_H
+#define OSAL_SYNC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Timeout of a wait that never times out
+#define OSAL_SYNC_FOREVER       0xFFFFFFFFUL
+
+// Event group wait options
+#define OSAL_EVGRP_ANY          0x00  // Wait for any of the bits
+#define OSAL_EVGRP_ALL          0x01  // Wait for all of the bits
+#define OSAL_EVGRP_CLEAR        0x02  // Clear the bits that satisfied the wait
+
+/*********************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// Waiter record, kept in a static pool
+struct osalSyncWaiter;
+
+// Counting semaphore
+typedef struct
+{
+  uint16_t               count;   // Units available
+  uint16_t               max;     // Highest count
+  struct osalSyncWaiter *waiters; // Waiting tasks, first come first served
+} osalSem_t;
+
+// Event group
+typedef struct
+{
+  uint16_t               bits;    // Bits currently set
+  struct osalSyncWaiter *waiters; // Waiting tasks
+} osalEventGroup_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+  /*
+   * Initialization for the OSAL semaphores and event groups.
+   */
+  extern void osalSyncInit( void );
+
+  /*
+   * Initialize a counting semaphore.
+   */
+  extern void osal_sem_init( osalSem_t *sem, uint16_t count, uint16_t max );
+
+  /*
+   * Take a unit of a semaphore, or wait for one and be notified with an event.
+   */
+  extern uint8_t osal_sem_take( osalSem_t *sem, uint8_t task_id, uint16_t event_id, uint32_t timeout );
+
+  /*
+   * Give a unit back to a semaphore, handing it to the first waiter.
+   */
+  extern uint8_t osal_sem_give( osalSem_t *sem );
+
+  /*
+   * Stop waiting for a semaphore.
+   */
+  extern uint8_t osal_sem_cancel( osalSem_t *sem, uint8_t task_id, uint16_t event_id );
+
+  /*
+   * Initialize an event group with no bits set.
+   */
+  extern void osal_evgrp_init( osalEventGroup_t *grp );
+
+  /*
+   * Set bits of an event group and notify the waiters they satisfy.
+   */
+  extern uint8_t osal_evgrp_set( osalEventGroup_t *grp, uint16_t bits );
+
+  /*
+   * Clear bits of an event group.
+   */
+  extern void osal_evgrp_clear( osalEventGroup_t *grp, uint16_t bits );
+
+  /*
+   * Read the bits of an event group.
+   */
+  extern uint16_t osal_evgrp_get( osalEventGroup_t *grp );
+
+  /*
+   * Wait for bits of an event group and be notified with an event.
+   */
+  extern uint8_t osal_evgrp_wait( osalEventGroup_t *grp, uint16_t bits, uint8_t options,
+                                  uint8_t task_id, uint16_t event_id, uint32_t timeout,
+                                  uint16_t *result );
+
+  /*
+   * Stop waiting for an event group.
+   */
+  extern uint8_t osal_evgrp_cancel( osalEventGroup_t *grp, uint8_t task_id, uint16_t event_id );
+
+/*********************************************************************
+*********************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSAL_SYNC_H */
@@ -29,10 +29,23 @@ extern "C"
  */
  #define OSAL_TIMERS_MAX_TIMEOUT 0x28f5c28e /* unit is ms*/
 
+// Handle value that never refers to a timer
+#define OSAL_TIMER_NO_HANDLE    0
+
+// Timer option flags
+#define OSAL_TIMER_DEFERRABLE   0x01  // Timer does not wake the device from power saving
+
 /*********************************************************************
  * TYPEDEFS
  */
 
+// Timer handle - slot index and generation of the timer record. A handle
+// becomes stale once its timer expires or is stopped.
+typedef uint32_t osalTimerHandle_t;
+
+// Callback timer function, called from the dispatching task
+typedef void (*pfnTimerCback_t)( uint8_t *pData );
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -66,6 +79,91 @@ extern "C"
    */
   extern uint32_t osal_get_timeoutEx( uint8_t task_id, uint16_t event_id );
 
+  /*
+   * Set a Timer that may expire up to 'slack' ms late
+   */
+  extern uint8_t osal_start_timer_slack( uint8_t task_id, uint16_t event_id, uint32_t timeout_value,
+                                         uint16_t slack, uint8_t flags );
+
+  /*
+   * Set a timer that reloads itself and may expire up to 'slack' ms late.
+   */
+  extern uint8_t osal_start_reload_timer_slack( uint8_t task_id, uint16_t event_id, uint32_t timeout_value,
+                                                uint16_t slack, uint8_t flags );
+
+  /*
+   * Set a Timer and return its handle
+   */
+  extern uint8_t osal_start_timer_handle( uint8_t task_id, uint16_t event_id, uint32_t timeout_value,
+                                          osalTimerHandle_t *handle );
+
+  /*
+   * Set a timer that reloads itself and return its handle.
+   */
+  extern uint8_t osal_start_reload_timer_handle( uint8_t task_id, uint16_t event_id, uint32_t timeout_value,
+                                                 osalTimerHandle_t *handle );
+
+  /*
+   * Restart a Timer by handle
+   */
+  extern uint8_t osal_restart_timer_handle( osalTimerHandle_t handle, uint32_t timeout_value );
+
+  /*
+   * Stop a Timer by handle
+   */
+  extern uint8_t osal_stop_timer_handle( osalTimerHandle_t handle );
+
+  /*
+   * Get the tick count of a Timer by handle.
+   */
+  extern uint32_t osal_get_timeout_handle( osalTimerHandle_t handle );
+
+  /*
+   * Read and clear the number of periods a reload timer missed
+   */
+  extern uint16_t osal_get_timer_overrun( uint8_t task_id, uint16_t event_id );
+
+  /*
+   * Read and clear the number of periods a reload timer missed, by handle
+   */
+  extern uint16_t osal_get_timer_overrun_handle( osalTimerHandle_t handle );
+
+  /*
+   * Set a Timer from an interrupt
+   */
+  extern uint8_t osal_start_timer_isr( uint8_t task_id, uint16_t event_id, uint32_t timeout_value );
+
+  /*
+   * Set a timer that reloads itself from an interrupt.
+   */
+  extern uint8_t osal_start_reload_timer_isr( uint8_t task_id, uint16_t event_id, uint32_t timeout_value );
+
+  /*
+   * Stop a Timer from an interrupt
+   */
+  extern uint8_t osal_stop_timer_isr( uint8_t task_id, uint16_t event_id );
+
+  /*
+   * Apply the timer commands queued from interrupts
+   */
+  extern void osalTimerDrainIsr( uint32_t tickDone );
+
+  /*
+   * Register the task event that dispatches callback timers
+   */
+  extern void osalTimerCbackInit( uint8_t task_id, uint16_t event_id );
+
+  /*
+   * Start a callback timer
+   */
+  extern uint8_t osal_start_cback_timer( pfnTimerCback_t pfnCback, uint8_t *pData, uint32_t timeout_value,
+                                         uint8_t reload, osalTimerHandle_t *handle );
+
+  /*
+   * Take the next expired callback timer for dispatch
+   */
+  extern uint8_t osalTimerCbackNext( pfnTimerCback_t *pfnCback, uint8_t **pData );
+
   /*
    * Adjust timer tables
    */
@@ -79,13 +177,23 @@ extern "C"
   /*
    * Count active timers
    */
-  extern uint8_t osal_timer_num_active( void );
+  extern uint16_t osal_timer_num_active( void );
+
+  /*
+   * Highest number of timers active at the same time
+   */
+  extern uint16_t osal_timer_high_water( void );
 
  /*
   * Read the system clock - returns milliseconds
   */
   extern uint32_t osal_GetSystemClock( void );
 
+ /*
+  * Read the system clock without wrap - returns milliseconds
+  */
+  extern uint64_t osal_GetSystemClock64( void );
+
   /*
    * Get the next OSAL timer expiration.
    * This function should only be called in OSAL_PwrMgr.c
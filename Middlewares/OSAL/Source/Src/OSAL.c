@@ -20,6 +20,8 @@
 #include "OSAL_Memory.h"
 #include "OSAL_Nv.h"
 #include "OSAL_Printf.h"
+#include "OSAL_Slab.h"
+#include "OSAL_Sync.h"
 
 #include "hal_drivers.h"
 
@@ -31,6 +33,12 @@
  * CONSTANTS
  */
 
+// Number of mutexes reserved in the mutex slab, further mutexes are
+// allocated from the heap.
+#if !defined OSAL_MUTEX_SLAB_CNT
+  #define OSAL_MUTEX_SLAB_CNT  4
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -42,7 +50,10 @@
 // Message Pool Definitions
 osal_msg_q_t osal_qHead;
 
-osal_mutex_t *osal_mutex_head = NULL;
+#if ( OSAL_TASK_ARENA_SIZE > 0 )
+// Scratch memory for the task being dispatched
+osalArena_t osal_task_arena;
+#endif
 
 /*********************************************************************
  * EXTERNAL VARIABLES
@@ -66,6 +77,10 @@ static uint8_t activeTaskID = TASK_NO_TASK;
 // osal_int_enable state
 static halIntState_t osal_int_state;
 
+// Mutex cache
+static osalSlab_t mutexSlab;
+static OSAL_SLAB_POOL( mutexPool, osal_mutex_t, OSAL_MUTEX_SLAB_CNT );
+
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
  */
@@ -905,10 +920,26 @@ uint32_t osal_rand( void )
  * MUTEX FUNCTIONS
  */
 
+/*********************************************************************
+ * @fn      osalMutexInit
+ *
+ * @brief   Initialization for the OSAL mutexes.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osalMutexInit( void )
+{
+  osal_slab_init( &mutexSlab, "mutex", mutexPool, OSAL_SLAB_OBJ_SIZE( osal_mutex_t ),
+                  OSAL_MUTEX_SLAB_CNT, OSAL_SLAB_HEAP_FALLBACK );
+}
+
 /*********************************************************************
  * @fn      osalMutexCreate
  *
- * @brief   create a muter
+ * @brief   create a muter. Mutexes are not linked anywhere, a lease
+ *          ends at its expiration time without any per-tick work.
  *
  * @param   none
  *
@@ -917,25 +948,10 @@ uint32_t osal_rand( void )
 osal_mutex_t* osalMutexCreate( void )
 {
     osal_mutex_t *ptr;
-    osal_mutex_t *pseach;
-    ptr = ( osal_mutex_t*)osal_mem_alloc( sizeof(osal_mutex_t) );
+    ptr = ( osal_mutex_t*)osal_slab_alloc( &mutexSlab );
     if( ptr != NULL )
     {
-        ptr->next_mutex = NULL;
-        ptr->mutex_value = FALSE;
-        if( osal_mutex_head == NULL )
-        {
-            osal_mutex_head = ptr;
-        }
-        else
-        {
-            pseach = osal_mutex_head;
-            while( pseach->next_mutex != NULL )
-            {
-                pseach = pseach->next_mutex;
-            }
-            pseach->next_mutex = ptr;
-        }
+        ptr->mutex_expire = 0;
     }
     return ptr;
 }
@@ -951,34 +967,15 @@ osal_mutex_t* osalMutexCreate( void )
  */
 void osalMutexDelete( osal_mutex_t** mutex )
 {
-    osal_mutex_t* pseach = osal_mutex_head;
-    if( pseach == NULL )
+    if( *mutex == NULL )
         return;
-    if( pseach == *mutex )
-    {
-        osal_mutex_head = (*mutex)->next_mutex;
-        osal_mem_free( (uint8_t*)(*mutex) );
-        *mutex = NULL;
-
-    }
-    else
-    {
-        while( (pseach->next_mutex != *mutex) && (pseach->next_mutex != NULL) )
-        {
-            pseach = pseach->next_mutex;
-        }
-        if( pseach->next_mutex == *mutex )
-        {
-            pseach->next_mutex = (*mutex)->next_mutex;
-            osal_mem_free( (uint8_t*)(*mutex) );
-            *mutex = NULL;
-        }
-    }
+    osal_slab_free( &mutexSlab, *mutex );
+    *mutex = NULL;
 }
 /*********************************************************************
  * @fn      osalMutexTake
  *
- * @brief  take a muter
+ * @brief  take a muter, the lease ends mutex_overtime ms from now
  *
  * @param   a pointer point to be taken muter
  *
@@ -992,7 +989,7 @@ void osalMutexTake( osal_mutex_t** mutex,uint32_t mutex_overtime )
     }
     if( *mutex != NULL )
     {
-        (*mutex)->mutex_value = mutex_overtime;
+        (*mutex)->mutex_expire = osal_GetSystemClock64() + mutex_overtime;
     }
 }
 /*********************************************************************
@@ -1008,7 +1005,7 @@ uint32_t osalMutexCheck( osal_mutex_t* mutex )
 {
     if( mutex == NULL )
         return FALSE;
-    if( mutex->mutex_value != 0 ) 
+    if( osal_GetSystemClock64() < mutex->mutex_expire )
         return TRUE;
     return FALSE;
 }
@@ -1025,34 +1022,11 @@ void osalMutexRelease( osal_mutex_t** mutex )
 {
     if( (*mutex) == NULL ) 
         return;
-    (*mutex)->mutex_value = 0;
+    (*mutex)->mutex_expire = 0;
     osalMutexDelete(mutex);
 }
 
 
-/*********************************************************************
- * @fn      osalMutexUpdate
- *
- * @brief   update mutex clock information
- *
- * @param  NONE
- *
- * @return NONE
- */
-void osalMutexUpdate( uint32_t mutexTime )
-{
-    osal_mutex_t *pseach;
-    pseach = osal_mutex_head;
-    while( pseach != NULL )
-    {
-        if( pseach->mutex_value > 0 )
-        {
-            pseach->mutex_value--;
-        }
-        pseach = pseach->next_mutex;
-    }
-}
-
 /*********************************************************************
  * MESSAGE FUNCTIONS
  */
@@ -1089,8 +1063,12 @@ uint8_t * osal_msg_allocate( uint16_t len )
   hdr = (osal_msg_hdr_t *) osal_mem_alloc( (short)(len + sizeof( osal_msg_hdr_t )) );
   if ( hdr )
   {
+#if ( OSAL_MSG_COMPACT )
+    hdr->next = 0;
+#else
     hdr->next = NULL;
     hdr->len = len;
+#endif
     hdr->dest_id = TASK_NO_TASK;
     return ( (uint8_t *) (hdr + 1) );
   }
@@ -1414,7 +1392,7 @@ void osal_msg_enqueue( osal_msg_q_t *q_ptr, void *msg_ptr )
   // Hold off interrupts
   HAL_ENTER_CRITICAL_SECTION(intState);
 
-  OSAL_MSG_NEXT( msg_ptr ) = NULL;
+  OSAL_MSG_SET_NEXT( msg_ptr, NULL );
   // If first message in queue
   if ( *q_ptr == NULL )
   {
@@ -1426,7 +1404,7 @@ void osal_msg_enqueue( osal_msg_q_t *q_ptr, void *msg_ptr )
     for ( list = *q_ptr; OSAL_MSG_NEXT( list ) != NULL; list = OSAL_MSG_NEXT( list ) );
 
     // Add message to end of queue
-    OSAL_MSG_NEXT( list ) = msg_ptr;
+    OSAL_MSG_SET_NEXT( list, msg_ptr );
   }
 
   // Re-enable interrupts
@@ -1457,7 +1435,7 @@ void *osal_msg_dequeue( osal_msg_q_t *q_ptr )
     // Dequeue message
     msg_ptr = *q_ptr;
     *q_ptr = OSAL_MSG_NEXT( msg_ptr );
-    OSAL_MSG_NEXT( msg_ptr ) = NULL;
+    OSAL_MSG_SET_NEXT( msg_ptr, NULL );
     OSAL_MSG_ID( msg_ptr ) = TASK_NO_TASK;
   }
 
@@ -1488,7 +1466,7 @@ void osal_msg_push( osal_msg_q_t *q_ptr, void *msg_ptr )
   HAL_ENTER_CRITICAL_SECTION(intState);
 
   // Push message to head of queue
-  OSAL_MSG_NEXT( msg_ptr ) = *q_ptr;
+  OSAL_MSG_SET_NEXT( msg_ptr, *q_ptr );
   *q_ptr = msg_ptr;
 
   // Re-enable interrupts
@@ -1524,9 +1502,9 @@ void osal_msg_extract( osal_msg_q_t *q_ptr, void *msg_ptr, void *prev_ptr )
   else
   {
     // remove from middle
-    OSAL_MSG_NEXT( prev_ptr ) = OSAL_MSG_NEXT( msg_ptr );
+    OSAL_MSG_SET_NEXT( prev_ptr, OSAL_MSG_NEXT( msg_ptr ) );
   }
-  OSAL_MSG_NEXT( msg_ptr ) = NULL;
+  OSAL_MSG_SET_NEXT( msg_ptr, NULL );
   OSAL_MSG_ID( msg_ptr ) = TASK_NO_TASK;
 
   // Re-enable interrupts
@@ -1576,7 +1554,7 @@ uint8_t osal_msg_enqueue_max( osal_msg_q_t *q_ptr, void *msg_ptr, uint8_t max )
     // Add message to end of queue if max not reached
     if ( max != 0 )
     {
-      OSAL_MSG_NEXT( list ) = msg_ptr;
+      OSAL_MSG_SET_NEXT( list, msg_ptr );
       ret = TRUE;
     }
   }
@@ -1762,6 +1740,17 @@ uint8_t osal_init_system( void )
   // Initialize the timers
   osalTimerInit();
 
+  // Initialize the mutexes
+  osalMutexInit();
+
+  // Initialize the semaphores and event groups
+  osalSyncInit();
+
+#if ( OSAL_TASK_ARENA_SIZE > 0 )
+  // Carve the task scratch arena
+  (void)osal_arena_init( &osal_task_arena, OSAL_TASK_ARENA_SIZE );
+#endif
+
   // Initialize the Power Management System
   osal_pwrmgr_init();
   
@@ -1824,6 +1813,8 @@ void osal_run_system( void )
 
 #ifndef USE_SYSTICK_IRQ
   osalTimeUpdate();
+#else
+  osalTickProcess();  // Catch up with the ticks counted by the tick interrupt
 #endif
 
   Hal_ProcessPoll();
@@ -1849,16 +1840,27 @@ void osal_run_system( void )
     events = (tasksArr[idx])( idx, events );
     activeTaskID = TASK_NO_TASK;
 
+#if ( OSAL_TASK_ARENA_SIZE > 0 )
+    // Release the scratch memory of this dispatch
+    osal_arena_reset( &osal_task_arena );
+#endif
+
     HAL_ENTER_CRITICAL_SECTION(intState);
     tasksEvents[idx] |= events;  // Add back unprocessed events to the current task.
     HAL_EXIT_CRITICAL_SECTION(intState);
   }
-#if defined( POWER_SAVING )
   else  // Complete pass through all task events with no activity?
   {
+#if ( OSALMEM_HANDLES )
+    (void)osal_mem_compact( OSALMEM_COMPACT_MOVES );  // Defragment the heap while idle
+#endif
+#if ( OSALMEM_TRACE )
+    OSAL_MemTrace_Hook();  // Drain the heap allocation trace while idle
+#endif
+#if defined( POWER_SAVING )
     osal_pwrmgr_powerconserve();  // Put the processor/system into sleep
-  }
 #endif
+  }
 
 }
 
@@ -3,7 +3,7 @@
   Revised:        $Date: 2014-11-04 15:36:27 -0800 (Tue, 04 Nov 2014) $
   Revision:       $Revision: 40989 $
 
-  Description:    This file contains the buffer management APIs. These APIs are not
+  Description:    This file contains the callback timer APIs. These APIs are not
                   reentrant hence cannot be called from an interrupt context.
 **************************************************************************************************/
 
@@ -20,42 +20,20 @@
 /*********************************************************************
  * MACROS
  */
-// Macros to convert one-dimensional index 'timer id' to two-dimensional indices
-// 'task id' and 'event id'.
-
-// Find out event id using timer id
-#define EVENT_ID( timerId )            ( 0x0001 << ( ( timerId ) % NUM_CBTIMERS_PER_TASK ) )
-
-// Find out task id using timer id
-#define TASK_ID( timerId )             ( ( ( timerId ) / NUM_CBTIMERS_PER_TASK ) + baseTaskID )
-
-// Find out bank task id using task id
-#define BANK_TASK_ID( taskId )         ( ( baseTaskID - ( taskId ) ) * NUM_CBTIMERS )
 
 /*********************************************************************
  * CONSTANTS
  */
-// Number of callback timers supported per task (limited by the number of OSAL event timers)
-#define NUM_CBTIMERS_PER_TASK          15
-
-// Total number of callback timers
-#define NUM_CBTIMERS                   ( OSAL_CBTIMER_NUM_TASKS * NUM_CBTIMERS_PER_TASK )
+// Event of the callback timer task, set while expired callbacks are queued
+#define CBTIMER_DISPATCH_EVT           0x0001
 
 /*********************************************************************
  * TYPEDEFS
  */
-// Callback Timer structure
-typedef struct
-{
-  pfnCbTimer_t  pfnCbTimer; // callback function to be called when timer expires
-  uint8_t        *pData;      // data to be passed in to callback function
-} cbTimer_t;
 
 /*********************************************************************
  * GLOBAL VARIABLES
  */
-// Callback Timer base task id
-uint16_t baseTaskID = TASK_NO_TASK;
 
 /*********************************************************************
  * EXTERNAL VARIABLES
@@ -68,20 +46,16 @@ uint16_t baseTaskID = TASK_NO_TASK;
 /*********************************************************************
  * LOCAL VARIABLES
  */
-// Callback Timers table.
-#if ( NUM_CBTIMERS > 0 )
-  cbTimer_t cbTimers[NUM_CBTIMERS];
-#endif
 
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
 
-static Status_t cbTimerSetup( pfnCbTimer_t  pfnCbTimer,
-                              uint8_t        *pData,
-                              uint32_t        timeout,
-                              uint8_t        *pTimerId,
-                              uint8_t         reload );
+static Status_t cbTimerSetup( pfnCbTimer_t       pfnCbTimer,
+                              uint8_t           *pData,
+                              uint32_t           timeout,
+                              osalTimerHandle_t *pTimerId,
+                              uint8_t            reload );
 
 /*********************************************************************
  * API FUNCTIONS
@@ -91,8 +65,7 @@ static Status_t cbTimerSetup( pfnCbTimer_t  pfnCbTimer,
 /*********************************************************************
  * @fn          osal_CbTimerInit
  *
- * @brief       Callback Timer task initialization function. This function
- *              can be called more than once (OSAL_CBTIMER_NUM_TASKS times).
+ * @brief       Callback Timer task initialization function.
  *
  * @param       taskId - Message Timer task ID.
  *
@@ -100,21 +73,16 @@ static Status_t cbTimerSetup( pfnCbTimer_t  pfnCbTimer,
  */
 void osal_CbTimerInit( uint8_t taskId )
 {
-  if ( baseTaskID == TASK_NO_TASK )
-  {
-    // Only initialize the base task id
-    baseTaskID = taskId;
-
-    // Initialize all timer structures
-    osal_memset( cbTimers, 0, sizeof( cbTimers ) );
-  }
+  osalTimerCbackInit( taskId, CBTIMER_DISPATCH_EVT );
 }
 
 
 /*********************************************************************
  * @fn          osal_CbTimerProcessEvent
  *
- * @brief       Callback Timer task event processing function.
+ * @brief       Callback Timer task event processing function. Calls
+ *              the callbacks of all expired timers, oldest first, with
+ *              interrupts enabled.
  *
  * @param       taskId - task ID.
  * @param       events - events.
@@ -123,6 +91,8 @@ void osal_CbTimerInit( uint8_t taskId )
  */
 uint16_t osal_CbTimerProcessEvent( uint8_t taskId, uint16_t events )
 {
+  (void)taskId;
+
   if ( events & SYS_EVENT_MSG )
   {
     // Process OSAL messages
@@ -131,51 +101,22 @@ uint16_t osal_CbTimerProcessEvent( uint8_t taskId, uint16_t events )
     return ( events ^ SYS_EVENT_MSG );
   }
 
-  if ( events )
+  if ( events & CBTIMER_DISPATCH_EVT )
   {
-    uint8_t i;
-    uint16_t event = 0;
-    halIntState_t cs;
+    pfnCbTimer_t pfnCbTimer;
+    uint8_t *pData;
 
-    HAL_ENTER_CRITICAL_SECTION(cs);
-
-    // Process event timers
-    for ( i = 0; i < NUM_CBTIMERS_PER_TASK; i++ )
+    // Each timer is taken off the queue before its callback runs, a
+    // one-shot timer is already freed and its id stale, so the callback
+    // may start, update or stop any timer, its own included.
+    while ( osalTimerCbackNext( &pfnCbTimer, &pData ) )
     {
-      if ( ( events >> i ) & 0x0001 )
-      {
-        cbTimer_t *pTimer = &cbTimers[BANK_TASK_ID( taskId )+i];
-
-        // Found the first event
-        event =  0x0001 << i;
-
-        // check there is a callback function to call
-        if ( pTimer->pfnCbTimer != NULL )
-        {
-          // Timer expired, call the registered callback function
-          pTimer->pfnCbTimer( pTimer->pData );
-        }
-
-        // check if the timer is still active
-        // Note: An active timer means the timer was started with reload!
-        if ( osal_get_timeoutEx( taskId, event ) == 0 )
-        {
-          // Mark entry as free
-          pTimer->pfnCbTimer = NULL;
-
-          // Null out data pointer
-          pTimer->pData = NULL;
-        }
-
-        // We only process one event at a time
-        break;
-      }
+      // Timer expired, call the registered callback function
+      pfnCbTimer( pData );
     }
 
-    HAL_EXIT_CRITICAL_SECTION(cs);
-
     // return unprocessed events
-    return ( events ^ event );
+    return ( events ^ CBTIMER_DISPATCH_EVT );
   }
 
   // If reach here, the events are unknown
@@ -204,10 +145,10 @@ uint16_t osal_CbTimerProcessEvent( uint8_t taskId, uint16_t events )
  *
  * @return  Success, or Failure.
  */
-Status_t osal_CbTimerStart( pfnCbTimer_t  pfnCbTimer,
-                            uint8_t        *pData,
-                            uint32_t        timeout,
-                            uint8_t        *pTimerId )
+Status_t osal_CbTimerStart( pfnCbTimer_t       pfnCbTimer,
+                            uint8_t           *pData,
+                            uint32_t           timeout,
+                            osalTimerHandle_t *pTimerId )
 {
   return ( cbTimerSetup( pfnCbTimer,
                          pData,
@@ -238,10 +179,10 @@ Status_t osal_CbTimerStart( pfnCbTimer_t  pfnCbTimer,
  *
  * @return  Success, or Failure.
  */
-Status_t osal_CbTimerStartReload( pfnCbTimer_t  pfnCbTimer,
-                                  uint8_t        *pData,
-                                  uint32_t        timeout,
-                                  uint8_t        *pTimerId )
+Status_t osal_CbTimerStartReload( pfnCbTimer_t       pfnCbTimer,
+                                  uint8_t           *pData,
+                                  uint32_t           timeout,
+                                  osalTimerHandle_t *pTimerId )
 {
   return ( cbTimerSetup( pfnCbTimer,
                          pData,
@@ -264,32 +205,14 @@ Status_t osal_CbTimerStartReload( pfnCbTimer_t  pfnCbTimer,
  *
  * @return  OSAL_SUCCESS or INVALIDPARAMETER if timer not found
  */
-Status_t osal_CbTimerUpdate( uint8_t timerId, uint32_t timeout )
+Status_t osal_CbTimerUpdate( osalTimerHandle_t timerId, uint32_t timeout )
 {
-  halIntState_t cs;
-
-  HAL_ENTER_CRITICAL_SECTION(cs);
-
-  // Look for the existing timer
-  if ( timerId < NUM_CBTIMERS )
+  // Only a running timer is updated, an expired one-shot timer is not
+  if ( osal_restart_timer_handle( timerId, timeout ) == OSAL_SUCCESS )
   {
-    if ( cbTimers[timerId].pfnCbTimer != NULL )
-    {
-      // Make sure the corresponding OSAL event timer is still running
-      if ( osal_get_timeoutEx( TASK_ID( timerId ), EVENT_ID( timerId ) ) != 0 )
-      {
-        // Timer exists; update it
-        osal_start_timerEx( TASK_ID( timerId ), EVENT_ID( timerId ), timeout );
-
-        HAL_EXIT_CRITICAL_SECTION(cs);
-
-        return (  OSAL_SUCCESS );
-      }
-    }
+    return ( OSAL_SUCCESS );
   }
 
-  HAL_EXIT_CRITICAL_SECTION(cs);
-
   // Timer not found
   return ( INVALIDPARAMETER );
 }
@@ -306,34 +229,14 @@ Status_t osal_CbTimerUpdate( uint8_t timerId, uint32_t timeout )
  *
  * @return  OSAL_SUCCESS or INVALIDPARAMETER if timer not found
  */
-Status_t osal_CbTimerStop( uint8_t timerId )
+Status_t osal_CbTimerStop( osalTimerHandle_t timerId )
 {
-  halIntState_t cs;
-
-  HAL_ENTER_CRITICAL_SECTION(cs);
-
-  // Look for the existing timer
-  if ( timerId < NUM_CBTIMERS )
+  // An expired timer whose callback is still queued is stopped too
+  if ( osal_stop_timer_handle( timerId ) == OSAL_SUCCESS )
   {
-    if ( cbTimers[timerId].pfnCbTimer != NULL )
-    {
-      // Timer exists; stop the OSAL event timer first
-      osal_stop_timerEx( TASK_ID( timerId ), EVENT_ID( timerId ) );
-
-      // Mark entry as free
-      cbTimers[timerId].pfnCbTimer = NULL;
-
-      // Null out data pointer
-      cbTimers[timerId].pData = NULL;
-
-      HAL_EXIT_CRITICAL_SECTION(cs);
-
-      return ( OSAL_SUCCESS );
-    }
+    return ( OSAL_SUCCESS );
   }
 
-  HAL_EXIT_CRITICAL_SECTION(cs);
-
   // Timer not found
   return ( INVALIDPARAMETER );
 }
@@ -362,59 +265,26 @@ Status_t osal_CbTimerStop( uint8_t timerId )
  *
  * @return  Success, or Failure.
  */
-static Status_t cbTimerSetup( pfnCbTimer_t  pfnCbTimer,
-                              uint8_t        *pData,
-                              uint32_t        timeout,
-                              uint8_t        *pTimerId,
-                              uint8_t         reload )
+static Status_t cbTimerSetup( pfnCbTimer_t       pfnCbTimer,
+                              uint8_t           *pData,
+                              uint32_t           timeout,
+                              osalTimerHandle_t *pTimerId,
+                              uint8_t            reload )
 {
-  uint8_t i;
-  halIntState_t cs;
-
-  HAL_ENTER_CRITICAL_SECTION(cs);
-
-  // Validate input parameters
-  if ( pfnCbTimer == NULL )
-  {
-    HAL_EXIT_CRITICAL_SECTION(cs);
+  osalTimerHandle_t timerId;
+  uint8_t status;
 
-    return ( INVALIDPARAMETER );
-  }
+  // The callback is kept in the OSAL timer record itself
+  status = osal_start_cback_timer( pfnCbTimer, pData, timeout, reload, &timerId );
 
-  // Look for an unused timer first
-  for ( i = 0; i < NUM_CBTIMERS; i++ )
+  // Check if the caller wants the timer Id
+  if ( pTimerId != NULL )
   {
-    if ( cbTimers[i].pfnCbTimer == NULL )
-    {
-      // Start the OSAL event timer first
-      if ( ( (reload==TRUE)          ?
-             osal_start_reload_timer :
-             osal_start_timerEx )( TASK_ID( i ), EVENT_ID( i ), timeout ) == OSAL_SUCCESS )
-      {
-        // Set up the callback timer
-        // Note: An odd pointer will be used to indicate to the process event
-        //       handler that the timer was started with reload.
-        cbTimers[i].pfnCbTimer = pfnCbTimer; //(pfnCbTimer_t)((uint32_t)pfnCbTimer | reload);
-        cbTimers[i].pData      = pData;
-
-        // Check if the caller wants the timer Id
-        if ( pTimerId != NULL )
-        {
-          // Caller is interested in the timer id
-          *pTimerId = i;
-        }
-
-        HAL_EXIT_CRITICAL_SECTION(cs);
-
-        return ( OSAL_SUCCESS );
-      }
-    }
+    // Caller is interested in the timer id
+    *pTimerId = timerId;
   }
 
-  HAL_EXIT_CRITICAL_SECTION(cs);
-
-  // No timer available
-  return ( NO_TIMER_AVAIL );
+  return ( status );
 }
 
 /****************************************************************************
@@ -19,14 +19,20 @@
  * MACROS
  */
 
-#define    YearLength(yr)    ((uint16_t)(IsLeapYear(yr) ? 366 : 365))
-
 /*********************************************************************
  * CONSTANTS
  */
 #define    BEGYEAR  2000     //  UTC started at 00:00:00 January 1, 2000
 
 #define    DAY      86400UL  // 24 hours * 60 minutes * 60 seconds
+
+// The calendar conversions count years from March, so that the leap day
+// ends a year, in 400-year eras of 146097 days
+#define    ERA_DAYS     146097UL
+#define    ERA_YEARS    400
+
+// Days from 0000-03-01 of the proleptic Gregorian calendar to 2000-01-01
+#define    BEGYEAR_DAYS 730425UL
                                   
 
 /* Check Below for an explanation */
@@ -126,6 +132,19 @@ static uint16_t remUsTicks = 0;
 
 static uint32_t timeMSec = 0;
 
+// Milliseconds counted by the tick interrupt, and the part of them already
+// applied to the clock and timers by osalTickProcess(). Without the tick
+// interrupt, osalTimeUpdate() advances both.
+static volatile uint32_t tickCount = 0;
+static uint32_t tickDone = 0;
+
+// Longest OSAL tick interrupt work, in OSAL_Timestamp_Hook() units
+static uint32_t tickIsrMax = 0;
+
+// Last reading of the microsecond counter and the wraps seen so far
+static uint32_t usLast = 0;
+static uint32_t usHigh = 0;
+
 // number of seconds since 0 hrs, 0 minutes, 0 seconds, on the
 // 1st of January 2000 UTC
 UTCTime OSAL_timeSeconds = 0;
@@ -133,7 +152,9 @@ UTCTime OSAL_timeSeconds = 0;
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
  */
-static uint8_t monthLength( uint8_t lpyr, uint8_t mon );
+static uint32_t daysFromCivil( uint16_t year, uint8_t month, uint8_t day );
+static void civilFromDays( uint32_t days, UTCTimeStruct *tm );
+static char *formatDigits2( char *pBuf, uint8_t val );
 
 static void osalClockUpdate( uint32_t elapsedMSec );
 
@@ -165,6 +186,9 @@ void osalTimeUpdate( void )
   uint32_t ticks320us;
   uint32_t elapsedMSec = 0;
 
+  // Apply the timer commands posted from interrupts
+  osalTimerDrainIsr( tickDone );
+
   HAL_ENTER_CRITICAL_SECTION(intState);
   // Get the free-running count of 320us timer ticks
   tmp = macMcuPrecisionCount();
@@ -199,10 +223,13 @@ void osalTimeUpdate( void )
       // Convert the 320 us ticks into milliseconds and a remainder
       CONVERT_320US_TO_MS_ELAPSED_REMAINDER( tmp, elapsedMSec, remUsTicks );
       
+      // Keep the tick count that interrupt timer commands are posted against
+      tickDone += elapsedMSec;
+      tickCount = tickDone;
+
       // Update OSAL Clock and Timers
       osalClockUpdate( elapsedMSec );
       osalTimerUpdate( elapsedMSec );
-      osalMutexUpdate( elapsedMSec );
     }
   }
 }
@@ -246,15 +273,144 @@ static void osalClockUpdate( uint32_t elapsedMSec )
  */
 void osalAdjustTimer(uint32_t Msec )
 {
+  uint32_t start = OSAL_Timestamp_Hook();
+
   /* Disable SysTick interrupts */ 
   SysTickIntDisable(); 
   
   osalClockUpdate(Msec);
   osalTimerUpdate(Msec);
-  osalMutexUpdate(Msec);
   
   /* Enable SysTick interrupts */ 
   SysTickIntEnable(); 
+
+  start = OSAL_Timestamp_Hook() - start;
+  if ( start > tickIsrMax )
+  {
+    tickIsrMax = start;
+  }
+}
+
+/*********************************************************************
+ * @fn      osalTickIncrement
+ *
+ * @brief   Count elapsed milliseconds from the tick interrupt. Only the
+ *          count is updated here, the clock and timers catch up
+ *          in osalTickProcess() from the OSAL loop. The count is only
+ *          written by the tick interrupt, so no interrupts are held off.
+ *
+ * @param   Msec - elapsed milliseconds
+ *
+ * @return  none
+ */
+void osalTickIncrement( uint32_t Msec )
+{
+  uint32_t start = OSAL_Timestamp_Hook();
+
+  tickCount += Msec;
+
+  start = OSAL_Timestamp_Hook() - start;
+  if ( start > tickIsrMax )
+  {
+    tickIsrMax = start;
+  }
+}
+
+/*********************************************************************
+ * @fn      osalTickProcess
+ *
+ * @brief   Apply the milliseconds counted by osalTickIncrement() since
+ *          the last call to the clock and timers, as one batch.
+ *          The timer commands posted from interrupts are applied first,
+ *          against the tick count they were posted at. Called from the
+ *          OSAL loop.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osalTickProcess( void )
+{
+  uint32_t count;
+  uint32_t elapsedMSec;
+
+  osalTimerDrainIsr( tickDone );
+
+  // Track the wraps of the microsecond counter
+  (void)osal_get_time_us64();
+
+  count = tickCount;
+  elapsedMSec = count - tickDone;
+
+  if ( elapsedMSec != 0 )
+  {
+    tickDone = count;
+
+    osalClockUpdate( elapsedMSec );
+    osalTimerUpdate( elapsedMSec );
+  }
+}
+
+/*********************************************************************
+ * @fn      osalTickPending
+ *
+ * @brief   Check for counted ticks that osalTickProcess() has not
+ *          applied yet - the OSAL loop must not sleep on them.
+ *
+ * @param   none
+ *
+ * @return  TRUE if ticks are pending, FALSE otherwise
+ */
+uint8_t osalTickPending( void )
+{
+  return ( (tickCount != tickDone) ? TRUE : FALSE );
+}
+
+/*********************************************************************
+ * @fn      osalTickCount
+ *
+ * @brief   Read the milliseconds counted by the tick interrupt so far,
+ *          including the ones not applied yet. Wraps at 32 bits.
+ *
+ * @param   none
+ *
+ * @return  tick count in milliseconds
+ */
+uint32_t osalTickCount( void )
+{
+  return ( tickCount );
+}
+
+/*********************************************************************
+ * @fn      osalTickLag
+ *
+ * @brief   Read the milliseconds counted by the tick interrupt that
+ *          osalTickProcess() has not applied to the clock and timers
+ *          yet. Timers started and clock reads from a task add them,
+ *          as the task may run well after the OSAL loop caught up.
+ *
+ * @param   none
+ *
+ * @return  pending milliseconds
+ */
+uint32_t osalTickLag( void )
+{
+  return ( tickCount - tickDone );
+}
+
+/*********************************************************************
+ * @fn      osal_tick_isr_max
+ *
+ * @brief   Return the longest time the OSAL spent in the tick interrupt,
+ *          in osalAdjustTimer() or osalTickIncrement().
+ *
+ * @param   none
+ *
+ * @return  duration in OSAL_Timestamp_Hook() units
+ */
+uint32_t osal_tick_isr_max( void )
+{
+  return ( tickIsrMax );
 }
 /*********************************************************************
  * @fn      osal_setClock
@@ -290,79 +446,146 @@ UTCTime osal_getClock( void )
 }
 
 /*********************************************************************
- * @fn      osal_ConvertUTCTime
+ * @fn      osal_get_time_us
  *
- * @brief   Converts UTCTime to UTCTimeStruct
+ * @brief   Read the free running microsecond counter of the port, for
+ *          timestamps finer than the millisecond tick. The counter is
+ *          independent of the OSAL clock and wraps at 32 bits.
  *
- * @param   tm - pointer to breakdown struct
+ * @param   none
  *
- * @param   secTime - number of seconds since 0 hrs, 0 minutes,
- *          0 seconds, on the 1st of January 2000 UTC
+ * @return  microseconds
+ */
+uint32_t osal_get_time_us( void )
+{
+  return ( OSAL_UsCounter_Hook() );
+}
+
+/*********************************************************************
+ * @fn      osal_get_time_us64
  *
- * @return  none
+ * @brief   Read the microsecond counter of the port extended to 64
+ *          bits. A wrap is seen when the counter reads lower than at
+ *          the previous call, so it must be read at least once per
+ *          wrap - osalTickProcess() reads it on every pass of the OSAL
+ *          loop.
+ *
+ * @param   none
+ *
+ * @return  microseconds
  */
-void osal_ConvertUTCTime( UTCTimeStruct *tm, UTCTime secTime )
+uint64_t osal_get_time_us64( void )
 {
-  // calculate the time less than a day - hours, minutes, seconds
-  {
-    uint32_t day = secTime % DAY;
-    tm->seconds = day % 60UL;
-    tm->minutes = (uint8_t)((day % 3600UL) / 60UL);
-    tm->hour = (uint8_t)(day / 3600UL);
-  }
+  halIntState_t intState;
+  uint32_t now;
+  uint32_t hi;
 
-  // Fill in the calendar - day, month, year
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  now = OSAL_UsCounter_Hook();
+  if ( now < usLast )
   {
-    uint16_t numDays = (uint16_t)(secTime / DAY);
-    tm->year = BEGYEAR;
-    while ( numDays >= YearLength( tm->year ) )
-    {
-      numDays -= YearLength( tm->year );
-      tm->year++;
-    }
+    usHigh++;
+  }
+  usLast = now;
+  hi = usHigh;
 
-    tm->month = 0;
-    while ( numDays >= monthLength( IsLeapYear( tm->year ), tm->month ) )
-    {
-      numDays -= monthLength( IsLeapYear( tm->year ), tm->month );
-      tm->month++;
-    }
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-    tm->day = (uint8_t)numDays;
-  }
+  return ( ((uint64_t)hi << 32) | now );
 }
 
 /*********************************************************************
- * @fn      monthLength
+ * @fn      daysFromCivil
  *
- * @param   lpyr - 1 for leap year, 0 if not
+ * @brief   Count the days from the 1st of January 2000 to a date, in
+ *          constant time.
  *
- * @param   mon - 0 - 11 (jan - dec)
+ * @param   year - 2000+
+ * @param   month - 1 - 12
+ * @param   day - 1 - 31
  *
- * @return  number of days in specified month
+ * @return  number of days
  */
-static uint8_t monthLength( uint8_t lpyr, uint8_t mon )
+static uint32_t daysFromCivil( uint16_t year, uint8_t month, uint8_t day )
 {
-  uint8_t days = 31;
+  uint32_t era;
+  uint32_t yoe;
+  uint32_t doy;
 
-  if ( mon == 1 ) // feb
+  // Years start in March, January and February belong to the year before
+  if ( month <= 2 )
   {
-    days = ( 28 + lpyr );
+    year--;
+    month += 9;
   }
   else
   {
-    if ( mon > 6 ) // aug-dec
-    {
-      mon--;
-    }
+    month -= 3;
+  }
 
-    if ( mon & 1 )
-    {
-      days = 30;
-    }
+  era = year / ERA_YEARS;
+  yoe = year - (era * ERA_YEARS);                 // [0, 399]
+  doy = ((153UL * month + 2) / 5) + day - 1;      // [0, 365]
+
+  return ( (era * ERA_DAYS) + (yoe * 365) + (yoe / 4) - (yoe / 100) + doy - BEGYEAR_DAYS );
+}
+
+/*********************************************************************
+ * @fn      civilFromDays
+ *
+ * @brief   Fill in the date that lies a number of days after the 1st of
+ *          January 2000, in constant time.
+ *
+ * @param   days - number of days
+ * @param   tm - receives the day, month and year
+ *
+ * @return  none
+ */
+static void civilFromDays( uint32_t days, UTCTimeStruct *tm )
+{
+  uint32_t era;
+  uint32_t doe;
+  uint32_t yoe;
+  uint32_t doy;
+  uint32_t mp;
+
+  days += BEGYEAR_DAYS;
+  era = days / ERA_DAYS;
+  doe = days - (era * ERA_DAYS);                                      // [0, 146096]
+  yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365;  // [0, 399]
+  doy = doe - ((365 * yoe) + (yoe / 4) - (yoe / 100));                // [0, 365]
+  mp = ((5 * doy) + 2) / 153;                                         // [0, 11] from March
+
+  tm->day = (uint8_t)(doy - (((153 * mp) + 2) / 5));
+  tm->month = (uint8_t)((mp < 10) ? (mp + 2) : (mp - 10));
+  tm->year = (uint16_t)((era * ERA_YEARS) + yoe + ((mp < 10) ? 0 : 1));
+}
+
+/*********************************************************************
+ * @fn      osal_ConvertUTCTime
+ *
+ * @brief   Converts UTCTime to UTCTimeStruct
+ *
+ * @param   tm - pointer to breakdown struct
+ *
+ * @param   secTime - number of seconds since 0 hrs, 0 minutes,
+ *          0 seconds, on the 1st of January 2000 UTC
+ *
+ * @return  none
+ */
+void osal_ConvertUTCTime( UTCTimeStruct *tm, UTCTime secTime )
+{
+  // calculate the time less than a day - hours, minutes, seconds
+  {
+    uint32_t day = secTime % DAY;
+    tm->seconds = day % 60UL;
+    tm->minutes = (uint8_t)((day % 3600UL) / 60UL);
+    tm->hour = (uint8_t)(day / 3600UL);
   }
 
-  return ( days );
+  // Fill in the calendar - day, month, year
+  civilFromDays( secTime / DAY, tm );
 }
 
 /*********************************************************************
@@ -381,32 +604,64 @@ UTCTime osal_ConvertUTCSecs( UTCTimeStruct *tm )
   /* Seconds for the partial day */
   seconds = (((tm->hour * 60UL) + tm->minutes) * 60UL) + tm->seconds;
 
-  /* Account for previous complete days */
-  {
-    /* Start with complete days in current month */
-    uint16_t days = tm->day;
+  /* Add total seconds before partial day */
+  seconds += daysFromCivil( tm->year, tm->month + 1, tm->day + 1 ) * DAY;
 
-    /* Next, complete months in current year */
-    {
-      int8_t month = tm->month;
-      while ( --month >= 0 )
-      {
-        days += monthLength( IsLeapYear( tm->year ), month );
-      }
-    }
+  return ( seconds );
+}
 
-    /* Next, complete years before current year */
-    {
-      uint16_t year = tm->year;
-      while ( --year >= BEGYEAR )
-      {
-        days += YearLength( year );
-      }
-    }
+/*********************************************************************
+ * @fn      formatDigits2
+ *
+ * @brief   Write a value as two decimal digits.
+ *
+ * @param   pBuf - buffer to write to
+ * @param   val - 0 - 99
+ *
+ * @return  pointer behind the digits
+ */
+static char *formatDigits2( char *pBuf, uint8_t val )
+{
+  pBuf[0] = (char)('0' + (val / 10));
+  pBuf[1] = (char)('0' + (val % 10));
 
-    /* Add total seconds before partial day */
-    seconds += (days * DAY);
-  }
+  return ( pBuf + 2 );
+}
 
-  return ( seconds );
+/*********************************************************************
+ * @fn      osal_FormatUTCTime
+ *
+ * @brief   Write a UTCTime as an ISO-8601 timestamp,
+ *          "YYYY-MM-DDThh:mm:ssZ", followed by a terminating 0.
+ *
+ * @param   pBuf - buffer of at least OSAL_UTC_ISO8601_LEN + 1 characters
+ *
+ * @param   secTime - number of seconds since 0 hrs, 0 minutes,
+ *          0 seconds, on the 1st of January 2000 UTC
+ *
+ * @return  number of characters written, without the terminating 0
+ */
+uint8_t osal_FormatUTCTime( char *pBuf, UTCTime secTime )
+{
+  UTCTimeStruct tm;
+  char *p = pBuf;
+
+  osal_ConvertUTCTime( &tm, secTime );
+
+  p = formatDigits2( p, (uint8_t)(tm.year / 100) );
+  p = formatDigits2( p, (uint8_t)(tm.year % 100) );
+  *p++ = '-';
+  p = formatDigits2( p, tm.month + 1 );
+  *p++ = '-';
+  p = formatDigits2( p, tm.day + 1 );
+  *p++ = 'T';
+  p = formatDigits2( p, tm.hour );
+  *p++ = ':';
+  p = formatDigits2( p, tm.minutes );
+  *p++ = ':';
+  p = formatDigits2( p, tm.seconds );
+  *p++ = 'Z';
+  *p = '\0';
+
+  return ( (uint8_t)(p - pBuf) );
 }
@@ -0,0 +1,231 @@
+/**************************************************************************************************
+  Filename:       OSAL_HrTimer.c
+  Revised:        $Date$
+  Revision:       $Revision$
+
+  Description:    OSAL high-resolution one-shot timers. The active timers are kept on a
+                  list sorted by expiration time and the port compare interrupt is armed
+                  for the first one.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "OSAL.h"
+
+#include "OSAL_HrTimer.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// Lock of the active list, shared with the compare interrupt. The host
+// port runs that interrupt on its own thread, under the heap lock.
+#if defined ( _WIN32 )
+  #define HRTIMER_LOCK(x)     OSALMEM_HEAP_LOCK(x)
+  #define HRTIMER_UNLOCK(x)   OSALMEM_HEAP_UNLOCK(x)
+#else
+  #define HRTIMER_LOCK(x)     HAL_ENTER_CRITICAL_SECTION(x)
+  #define HRTIMER_UNLOCK(x)   HAL_EXIT_CRITICAL_SECTION(x)
+#endif
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Active timers, earliest expiration first
+static osalHrTimer_t *hrTimerHead;
+
+// Latest callback so far, in microseconds
+static uint32_t hrTimerMaxLate;
+
+/*********************************************************************
+ * LOCAL FUNCTION PROTOTYPES
+ */
+static uint8_t hrTimerUnlink( osalHrTimer_t *pTimer );
+
+/*********************************************************************
+ * FUNCTIONS
+ *********************************************************************/
+
+/*********************************************************************
+ * @fn      hrTimerUnlink
+ *
+ * @brief   Take a timer off the active list.
+ *          Ints must be disabled.
+ *
+ * @param   pTimer - timer to take off
+ *
+ * @return  TRUE if the timer was active, FALSE otherwise
+ */
+static uint8_t hrTimerUnlink( osalHrTimer_t *pTimer )
+{
+  osalHrTimer_t **link;
+
+  for ( link = &hrTimerHead; *link != NULL; link = &(*link)->next )
+  {
+    if ( *link == pTimer )
+    {
+      *link = pTimer->next;
+      return ( TRUE );
+    }
+  }
+
+  return ( FALSE );
+}
+
+/*********************************************************************
+ * @fn      osal_hr_timer_start
+ *
+ * @brief   Start a high-resolution one-shot timer, or restart it if it
+ *          is already running. The callback is called from the compare
+ *          interrupt of the port once the timeout has elapsed on the
+ *          microsecond counter.
+ *
+ * @param   pTimer - timer, must stay valid while it runs
+ * @param   timeout_us - timeout in microseconds, at most
+ *                       OSAL_HRTIMER_MAX_TIMEOUT
+ * @param   pfnCback - callback function
+ * @param   pData - data passed to the callback
+ *
+ * @return  OSAL_SUCCESS or INVALIDPARAMETER
+ */
+uint8_t osal_hr_timer_start( osalHrTimer_t *pTimer, uint32_t timeout_us,
+                             pfnHrTimerCback_t pfnCback, void *pData )
+{
+  halIntState_t intState;
+  osalHrTimer_t **link;
+
+  if ( (pTimer == NULL) || (pfnCback == NULL) || (timeout_us > OSAL_HRTIMER_MAX_TIMEOUT) )
+  {
+    return ( INVALIDPARAMETER );
+  }
+
+  HRTIMER_LOCK( intState );    // Hold off interrupts.
+
+  (void)hrTimerUnlink( pTimer );
+
+  pTimer->expire = OSAL_UsCounter_Hook() + timeout_us;
+  pTimer->pfnCback = pfnCback;
+  pTimer->pData = pData;
+
+  // Keep the list sorted, behind the timers with the same expiration
+  for ( link = &hrTimerHead; *link != NULL; link = &(*link)->next )
+  {
+    if ( OSAL_TIME_AFTER( (*link)->expire, pTimer->expire ) )
+    {
+      break;
+    }
+  }
+  pTimer->next = *link;
+  *link = pTimer;
+
+  // A new first timer moves the compare point
+  if ( hrTimerHead == pTimer )
+  {
+    OSAL_UsCompare_Hook( pTimer->expire );
+  }
+
+  HRTIMER_UNLOCK( intState );  // Re-enable interrupts.
+
+  return ( OSAL_SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      osal_hr_timer_stop
+ *
+ * @brief   Stop a high-resolution timer, its callback will not be
+ *          called.
+ *
+ * @param   pTimer - timer to stop
+ *
+ * @return  OSAL_SUCCESS or INVALID_EVENT_ID if the timer is not running
+ */
+uint8_t osal_hr_timer_stop( osalHrTimer_t *pTimer )
+{
+  halIntState_t intState;
+  uint8_t found;
+
+  HRTIMER_LOCK( intState );    // Hold off interrupts.
+
+  found = hrTimerUnlink( pTimer );
+
+  // The compare may still fire for the stopped timer, osal_hr_timer_isr()
+  // then finds nothing due and re-arms for the new first timer.
+
+  HRTIMER_UNLOCK( intState );  // Re-enable interrupts.
+
+  return ( found ? OSAL_SUCCESS : INVALID_EVENT_ID );
+}
+
+/*********************************************************************
+ * @fn      osal_hr_timer_max_late
+ *
+ * @brief   Return the latest callback seen so far, the time from the
+ *          expiration of a timer until its callback was called.
+ *
+ * @param   none
+ *
+ * @return  latency in microseconds
+ */
+uint32_t osal_hr_timer_max_late( void )
+{
+  return ( hrTimerMaxLate );
+}
+
+/*********************************************************************
+ * @fn      osal_hr_timer_isr
+ *
+ * @brief   Call the callbacks of all due timers and arm the compare
+ *          interrupt for the next one. Called by the port from the
+ *          compare interrupt, callbacks run with interrupts enabled
+ *          and may restart their timer.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osal_hr_timer_isr( void )
+{
+  halIntState_t intState;
+  osalHrTimer_t *pTimer;
+  uint32_t now;
+
+  for ( ;; )
+  {
+    HRTIMER_LOCK( intState );    // Hold off interrupts.
+
+    now = OSAL_UsCounter_Hook();
+    pTimer = hrTimerHead;
+
+    if ( (pTimer != NULL) && OSAL_TIME_BEFORE_EQ( pTimer->expire, now ) )
+    {
+      hrTimerHead = pTimer->next;
+
+      if ( (now - pTimer->expire) > hrTimerMaxLate )
+      {
+        hrTimerMaxLate = now - pTimer->expire;
+      }
+    }
+    else
+    {
+      if ( pTimer != NULL )
+      {
+        OSAL_UsCompare_Hook( pTimer->expire );
+      }
+      pTimer = NULL;
+    }
+
+    HRTIMER_UNLOCK( intState );  // Re-enable interrupts.
+
+    if ( pTimer == NULL )
+    {
+      break;
+    }
+
+    pTimer->pfnCback( pTimer->pData );
+  }
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -17,6 +17,7 @@
 
 #include "OSAL_Memory.h"
 #include "OSAL_Printf.h"
+#include "OSAL_Timers.h"
 
 /* ------------------------------------------------------------------------------------------------
  *                                           Constants
@@ -103,14 +104,52 @@
 // fast comparisons with zero to determine the end of the heap.
 #define OSALMEM_LASTBLK_IDX      ((MAXMEMHEAP / OSALMEM_HDRSZ) - 1)
 
-// For information about memory profiling, refer to SWRA204 "Heap Memory Management", section 1.5.
-#if !defined OSALMEM_PROFILER
-#define OSALMEM_PROFILER           TRUE  // Enable/disable the memory usage profiling buckets.
+/* The first-fit search of osal_mem_alloc() briefly re-enables interrupts after examining this many
+ * block headers, which bounds the interrupt-off time independently of the heap fragmentation.
+ * A search that was interrupted by a heap change starts over; after OSALMEM_CS_RETRY restarts it
+ * is finished with interrupts held off so that it cannot be starved.
+ */
+#if !defined OSALMEM_CS_STEPS
+#define OSALMEM_CS_STEPS           8
+#endif
+#if !defined OSALMEM_CS_RETRY
+#define OSALMEM_CS_RETRY           2
 #endif
+
 #if !defined OSALMEM_PROFILER_LL
 #define OSALMEM_PROFILER_LL        TRUE  // Special profiling of the Long-Lived bucket.
 #endif
 
+#if OSALMEM_TRACE && (OSALMEM_TRACE_CNT & (OSALMEM_TRACE_CNT - 1))
+#error OSALMEM_TRACE_CNT must be a power of 2!
+#endif
+
+#if OSALMEM_CTX_CACHE && (OSALMEM_CACHE_BATCH > OSALMEM_CACHE_DEPTH)
+#error OSALMEM_CACHE_BATCH must not exceed OSALMEM_CACHE_DEPTH!
+#endif
+
+#if OSALMEM_HANDLES && (OSALMEM_HANDLE_CNT > 255)
+#error OSALMEM_HANDLE_CNT must not exceed 255!
+#endif
+
+#if OSALMEM_CS_STATS
+#define OSALMEM_ENTER_CS(x)       st( OSALMEM_HEAP_LOCK(x); memCsStart = OSAL_Timestamp_Hook(); )
+#define OSALMEM_EXIT_CS(x)        st( osalMemCsEnd(); OSALMEM_HEAP_UNLOCK(x); )
+#else
+#define OSALMEM_ENTER_CS(x)       OSALMEM_HEAP_LOCK(x)
+#define OSALMEM_EXIT_CS(x)        OSALMEM_HEAP_UNLOCK(x)
+#endif
+
+#if OSALMEM_CTX_CACHE
+// Cached blocks are sorted by size, from the smallest block of two headers up to OSALMEM_SMALL_BLKSZ.
+// A header-only block, as from osal_mem_alloc(0), has no room for the link and is never cached.
+#define OSALMEM_CACHE_MIN         (OSALMEM_HDRSZ * 2)
+#define OSALMEM_CACHE_CLASSES     ((OSALMEM_SMALL_BLKSZ / OSALMEM_HDRSZ) - 1)
+#define OSALMEM_CACHE_CLASS(LEN)  (((LEN) / OSALMEM_HDRSZ) - 2)
+// A cached block links to the next one by its header index + 1, which fits into any block.
+#define OSALMEM_CACHE_LINK(HDR)   (*(uint16_t *)((HDR) + 1))
+#endif
+
 #if OSALMEM_PROFILER
 #define OSALMEM_INIT              'X'
 #define OSALMEM_ALOC              'A'
@@ -152,6 +191,7 @@ static osalMemHdr_t *ff1;  // First free block in the small-block bucket.
 #endif
 
 static uint8_t osalMemStat;            // Discrete status flags: 0x01 = kicked.
+static uint16_t osalMemGen;            // Bumped when blocks are split, merged or taken in use.
 
 #if OSALMEM_METRICS
 static uint16_t blkMax;  // Max cnt of all blocks ever seen at once.
@@ -162,7 +202,6 @@ static uint16_t memMax;  // Max total memory ever allocated at once.
 #endif
 
 #if OSALMEM_PROFILER
-#define OSALMEM_PROMAX  8
 /* The profiling buckets must differ by at least OSALMEM_MIN_BLKSZ; the
  * last bucket must equal the max alloc size. Set the bucket sizes to
  * whatever sizes necessary to show how your application is using memory.
@@ -175,64 +214,155 @@ static uint16_t proTot[OSALMEM_PROMAX+1] = { 0 };
 static uint16_t proSmallBlkMiss;
 #endif
 
+#if OSALMEM_HANDLES
+typedef struct {
+  osalMemHdr_t *hdr;  // Header of the movable block, NULL if the handle is free.
+  uint8_t lockCnt;    // The block is pinned while this is non-zero.
+} osalMemHdl_t;
+
+static osalMemHdl_t memHdl[OSALMEM_HANDLE_CNT];
+static osalMemHdr_t *memCompactPos;  // Where the compactor stopped, NULL between passes.
+static uint16_t memCompactGen;       // 'osalMemGen' when the compactor stopped.
+static osalMemCompactStats_t memCompact;
+static osalMemFrag_t memCompactFrag; // Free runs seen so far by the current pass.
+static uint16_t memCompactRun;       // Size of the free run the compactor is in.
+#endif
+
+#if OSALMEM_CTX_CACHE
+/* A cache is only ever used by its own context, so it is accessed without locking. Contexts that
+ * may preempt each other must therefore have distinct ids, see OSAL_Context_Hook().
+ */
+typedef struct {
+  uint16_t list[OSALMEM_CACHE_CLASSES];  // First cached block of each size, header index + 1.
+  uint8_t cnt[OSALMEM_CACHE_CLASSES];    // Number of cached blocks of each size.
+  osalMemCacheStats_t stats;
+} osalMemCache_t;
+
+static osalMemCache_t memCache[OSALMEM_CTX_CNT];
+#endif
+
+#if OSALMEM_CS_STATS
+static uint32_t memCsStart;  // OSAL_Timestamp_Hook() when ints were last held off.
+static osalMemCsStats_t memCs;
+#endif
+
+#if OSALMEM_TRACE
+static osalMemTraceRec_t memTrace[OSALMEM_TRACE_CNT];
+static uint16_t memTraceHead;  // Free running count of records written.
+static uint16_t memTraceTail;  // Free running count of records consumed.
+static uint16_t memTraceLost;  // Records overwritten before they were consumed.
+#endif
+
 /* ------------------------------------------------------------------------------------------------
- *                                           Global Variables
+ *                                           Local Functions
  * ------------------------------------------------------------------------------------------------
  */
 
 /**************************************************************************************************
- * @fn          osal_mem_init
+ * @fn          osalMemBlkSize
  *
- * @brief       This function is the OSAL heap memory management initialization callback.
+ * @brief       Compute the total block size needed for an allocation.
  *
  * input parameters
  *
- * None.
+ * @param size - the number of bytes requested.
  *
  * output parameters
  *
  * None.
  *
- * @return      None.
+ * @return      Block size including the header, aligned to halDataAlign_t.
  */
-void osal_mem_init(void)
+static uint16_t osalMemBlkSize(uint16_t size)
 {
-  HAL_ASSERT(((OSALMEM_MIN_BLKSZ % OSALMEM_HDRSZ) == 0));
-  HAL_ASSERT(((OSALMEM_LL_BLKSZ % OSALMEM_HDRSZ) == 0));
-  HAL_ASSERT(((OSALMEM_SMALL_BLKSZ % OSALMEM_HDRSZ) == 0));
+  size += OSALMEM_HDRSZ;
 
-#if OSALMEM_PROFILER
-  (void)osal_memset(theHeap, OSALMEM_INIT, MAXMEMHEAP);
-#endif
+  // Calculate required bytes to add to 'size' to align to halDataAlign_t.
+  if ( sizeof( halDataAlign_t ) == 2 )
+  {
+    size += (size & 0x01);
+  }
+  else if ( sizeof( halDataAlign_t ) != 1 )
+  {
+    const uint8_t mod = size % sizeof( halDataAlign_t );
 
-  // Setup a NULL block at the end of the heap for fast comparisons with zero.
-  theHeap[OSALMEM_LASTBLK_IDX].val = 0;
+    if ( mod != 0 )
+    {
+      size += (sizeof( halDataAlign_t ) - mod);
+    }
+  }
 
-  // Setup the small-block bucket.
-  ff1 = theHeap;
-  ff1->val = OSALMEM_SMALLBLK_BUCKET;                   // Set 'len' & clear 'inUse' field.
-  // Set 'len' & 'inUse' fields - this is a 'zero data bytes' lifetime allocation to block the
-  // small-block bucket from ever being coalesced with the wilderness.
-  theHeap[OSALMEM_SMALLBLK_HDRCNT].val = (OSALMEM_HDRSZ | OSALMEM_IN_USE);
+  return size;
+}
 
-  // Setup the wilderness.
-  theHeap[OSALMEM_BIGBLK_IDX].val = OSALMEM_BIGBLK_SZ;  // Set 'len' & clear 'inUse' field.
+/**************************************************************************************************
+ * @fn          osalMemSearchStart
+ *
+ * @brief       Find the block where the first-fit search for an allocation starts.
+ *              Ints must be disabled.
+ *
+ * input parameters
+ *
+ * @param size - total block size, including the header.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      Header of the first block to examine.
+ */
+static osalMemHdr_t *osalMemSearchStart(uint16_t size)
+{
+  // Smaller allocations are first attempted in the small-block bucket, and all long-lived
+  // allocations are channelled into the LL block reserved within this bucket.
+  if ((osalMemStat == 0) || (size <= OSALMEM_SMALL_BLKSZ))
+  {
+    return ff1;
+  }
+  else
+  {
+    return (theHeap + OSALMEM_BIGBLK_IDX);
+  }
+}
 
-#if ( OSALMEM_METRICS )
-  /* Start with the small-block bucket and the wilderness - don't count the
-   * end-of-heap NULL block nor the end-of-small-block NULL block.
-   */
-  blkCnt = blkFree = 2;
-#endif
+#if OSALMEM_PROFILER
+/**************************************************************************************************
+ * @fn          osalMemProIdx
+ *
+ * @brief       Find the profiling bucket of a block size.
+ *
+ * input parameters
+ *
+ * @param len - total block size, including the header.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      Index of the profiling bucket.
+ */
+static uint8_t osalMemProIdx(uint16_t len)
+{
+  uint8_t idx;
+
+  for (idx = 0; idx < OSALMEM_PROMAX; idx++)
+  {
+    if (len <= proCnt[idx])
+    {
+      break;
+    }
+  }
+
+  return idx;
 }
+#endif
 
+#if OSALMEM_CS_STATS
 /**************************************************************************************************
- * @fn          osal_mem_kick
+ * @fn          osalMemCsEnd
  *
- * @brief       This function is the OSAL task initialization callback.
- * @brief       Kick the ff1 pointer out past the long-lived OSAL Task blocks.
- *              Invoke this once after all long-lived blocks have been allocated -
- *              presently at the end of osal_init_system().
+ * @brief       Account the length of the interrupt-off section that is about to end.
+ *              Ints must be disabled.
  *
  * input parameters
  *
@@ -244,33 +374,31 @@ void osal_mem_init(void)
  *
  * @return      None.
  */
-void osal_mem_kick(void)
+static void osalMemCsEnd(void)
 {
-  halIntState_t intState;
-  osalMemHdr_t *tmp = osal_mem_alloc(1);
-
-  HAL_ASSERT((tmp != NULL));
-  HAL_ENTER_CRITICAL_SECTION(intState);  // Hold off interrupts.
-
-  /* All long-lived allocations have filled the LL block reserved in the small-block bucket.
-   * Set 'osalMemStat' so searching for memory in this bucket from here onward will only be done
-   * for sizes meeting the OSALMEM_SMALL_BLKSZ criteria.
-   */
-  ff1 = tmp - 1;       // Set 'ff1' to point to the first available memory after the LL block.
-  osal_mem_free(tmp);
-  osalMemStat = 0x01;  // Set 'osalMemStat' after the free because it enables memory profiling.
+  uint32_t len = OSAL_Timestamp_Hook() - memCsStart;
 
-  HAL_EXIT_CRITICAL_SECTION(intState);  // Re-enable interrupts.
+  if (memCs.csMax < len)
+  {
+    memCs.csMax = len;
+  }
 }
+#endif
 
+#if OSALMEM_TRACE
 /**************************************************************************************************
- * @fn          osal_mem_alloc
+ * @fn          osalMemTraceAdd
  *
- * @brief       This function implements the OSAL dynamic memory allocation functionality.
+ * @brief       Append a record to the allocation trace ring, overwriting the oldest record
+ *              when the ring is full. Ints must be disabled.
  *
  * input parameters
  *
- * @param size - the number of bytes to allocate from the HEAP.
+ * @param op - OSALMEM_TRACE_ALLOC or OSALMEM_TRACE_FREE.
+ * @param size - requested bytes for an alloc, block bytes for a free.
+ * @param hdr - header of the block, NULL if the allocation failed.
+ * @param fname - call site file name.
+ * @param lnum - call site line number.
  *
  * output parameters
  *
@@ -278,46 +406,53 @@ void osal_mem_kick(void)
  *
  * @return      None.
  */
-#ifdef DPRINTF_OSALHEAPTRACE
-void *osal_mem_alloc_dbg( uint16_t size, const char *fname, unsigned lnum )
-#else /* DPRINTF_OSALHEAPTRACE */
-void *osal_mem_alloc( uint16_t size )
-#endif /* DPRINTF_OSALHEAPTRACE */
+static void osalMemTraceAdd(uint8_t op, uint16_t size, osalMemHdr_t *hdr, const char *fname, unsigned lnum)
 {
-  osalMemHdr_t *prev = NULL;
-  osalMemHdr_t *hdr;
-  halIntState_t intState;
-  uint8_t coal = 0;
-
-  size += OSALMEM_HDRSZ;
+  osalMemTraceRec_t *rec = memTrace + (memTraceHead++ & (OSALMEM_TRACE_CNT - 1));
 
-  // Calculate required bytes to add to 'size' to align to halDataAlign_t.
-  if ( sizeof( halDataAlign_t ) == 2 )
+  if ((uint16_t)(memTraceHead - memTraceTail) > OSALMEM_TRACE_CNT)
   {
-    size += (size & 0x01);
+    memTraceTail++;
+    memTraceLost++;
   }
-  else if ( sizeof( halDataAlign_t ) != 1 )
-  {
-    const uint8_t mod = size % sizeof( halDataAlign_t );
 
-    if ( mod != 0 )
-    {
-      size += (sizeof( halDataAlign_t ) - mod);
-    }
-  }
+  rec->time = osal_GetSystemClock();
+  rec->file = (uint32_t)(size_t)fname;
+  rec->line = (uint16_t)lnum;
+  rec->size = size;
+  rec->offset = (hdr != NULL) ? (uint16_t)((uint8_t *)hdr - (uint8_t *)theHeap) : OSALMEM_TRACE_NOBLK;
+  rec->op = op;
+  rec->task = osal_self();
+}
+#endif
 
-  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+/**************************************************************************************************
+ * @fn          osalMemFind
+ *
+ * @brief       Find a free block by first-fit, split it as needed and take it in use. The heap must
+ *              be locked; the lock is briefly released every OSALMEM_CS_STEPS block headers.
+ *
+ * input parameters
+ *
+ * @param size - total block size, including the header.
+ * @param intState - lock state of the caller.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      Header of the allocated block, NULL if none is available.
+ */
+static osalMemHdr_t *osalMemFind(uint16_t size, halIntState_t *intState)
+{
+  osalMemHdr_t *prev = NULL;
+  osalMemHdr_t *hdr;
+  uint16_t steps = 0;
+  uint16_t gen;
+  uint8_t retry = 0;
+  uint8_t coal = 0;
 
-  // Smaller allocations are first attempted in the small-block bucket, and all long-lived
-  // allocations are channelled into the LL block reserved within this bucket.
-  if ((osalMemStat == 0) || (size <= OSALMEM_SMALL_BLKSZ))
-  {
-    hdr = ff1;
-  }
-  else
-  {
-    hdr = (theHeap + OSALMEM_BIGBLK_IDX);
-  }
+  hdr = osalMemSearchStart(size);
 
   do
   {
@@ -335,6 +470,7 @@ void *osal_mem_alloc( uint16_t size )
 #endif
 
         prev->hdr.len += hdr->hdr.len;
+        osalMemGen++;
 
         if ( prev->hdr.len >= size )
         {
@@ -361,8 +497,47 @@ void *osal_mem_alloc( uint16_t size )
       hdr = NULL;
       break;
     }
+
+    /* Let pending interrupts in after every OSALMEM_CS_STEPS headers. The search resumes where it
+     * left off unless the heap was changed meanwhile, in which case it starts over.
+     */
+    if ( (++steps >= OSALMEM_CS_STEPS) && (retry <= OSALMEM_CS_RETRY) )
+    {
+#if ( OSALMEM_CS_STATS )
+      if ( memCs.stepMax < steps )
+      {
+        memCs.stepMax = steps;
+      }
+#endif
+      steps = 0;
+      gen = osalMemGen;
+
+      OSALMEM_EXIT_CS( *intState );   // Re-enable interrupts.
+      OSALMEM_ENTER_CS( *intState );  // Hold off interrupts.
+
+      if ( gen != osalMemGen )
+      {
+#if ( OSALMEM_CS_STATS )
+        memCs.restarts++;
+        if ( retry == OSALMEM_CS_RETRY )
+        {
+          memCs.locked++;
+        }
+#endif
+        retry++;
+        coal = 0;
+        hdr = osalMemSearchStart(size);
+      }
+    }
   } while (1);
 
+#if ( OSALMEM_CS_STATS )
+  if ( memCs.stepMax < steps )
+  {
+    memCs.stepMax = steps;
+  }
+#endif
+
   if ( hdr != NULL )
   {
     uint16_t tmp = hdr->hdr.len - size;
@@ -394,6 +569,8 @@ void *osal_mem_alloc( uint16_t size )
       hdr->hdr.inUse = TRUE;
     }
 
+    osalMemGen++;
+
 #if ( OSALMEM_METRICS )
     if ( memMax < memAlo )
     {
@@ -406,15 +583,8 @@ void *osal_mem_alloc( uint16_t size )
     if (osalMemStat != 0)  // Don't profile until after the LL block is filled.
 #endif
     {
-      uint8_t idx;
+      uint8_t idx = osalMemProIdx(hdr->hdr.len);
 
-      for ( idx = 0; idx < OSALMEM_PROMAX; idx++ )
-      {
-        if ( hdr->hdr.len <= proCnt[idx] )
-        {
-          break;
-        }
-      }
       proCur[idx]++;
       if ( proMax[idx] < proCur[idx] )
       {
@@ -435,8 +605,6 @@ void *osal_mem_alloc( uint16_t size )
         proSmallBlkMiss++;
       }
     }
-
-    (void)osal_memset((uint8_t *)(hdr+1), OSALMEM_ALOC, (hdr->hdr.len - OSALMEM_HDRSZ));
 #endif
 
     if ((osalMemStat != 0) && (ff1 == hdr))
@@ -444,51 +612,90 @@ void *osal_mem_alloc( uint16_t size )
       ff1 = (osalMemHdr_t *)((uint8_t *)hdr + hdr->hdr.len);
     }
 
-    hdr++;
   }
 
-  HAL_EXIT_CRITICAL_SECTION( intState );  // Re-enable interrupts.
-
-  HAL_ASSERT(((size_t)hdr % sizeof(halDataAlign_t)) == 0);
 
-#ifdef DPRINTF_OSALHEAPTRACE
-  printf("osal_mem_alloc(%u)->%lx:%s:%u\n", size, (unsigned) hdr, fname, lnum);
-#endif /* DPRINTF_OSALHEAPTRACE */
-  return (void *)hdr;
+  return hdr;
 }
 
 /**************************************************************************************************
- * @fn          osal_mem_free
+ * @fn          osalMemStep
  *
- * @brief       This function implements the OSAL dynamic memory de-allocation functionality.
+ * @brief       Count a block header visited by a heap walk and let pending interrupts in after every
+ *              OSALMEM_CS_STEPS of them, like osalMemFind(). After OSALMEM_CS_RETRY restarts the walk
+ *              is finished with the heap locked so that it cannot be starved. The heap must be locked.
  *
  * input parameters
  *
- * @param ptr - A valid pointer (i.e. a pointer returned by osal_mem_alloc()) to the memory to free.
+ * @param steps - headers visited since the lock was last released.
+ * @param gen - 'osalMemGen' the walk started at, updated on a restart.
+ * @param retry - restarts so far.
+ * @param intState - lock state of the caller.
  *
  * output parameters
  *
  * None.
  *
- * @return      None.
+ * @return      TRUE if blocks were split or merged meanwhile and the walk must start over.
  */
-#ifdef DPRINTF_OSALHEAPTRACE
-void osal_mem_free_dbg(void *ptr, const char *fname, unsigned lnum)
-#else /* DPRINTF_OSALHEAPTRACE */
-void osal_mem_free(void *ptr)
-#endif /* DPRINTF_OSALHEAPTRACE */
+static uint8_t osalMemStep(uint16_t *steps, uint16_t *gen, uint8_t *retry, halIntState_t *intState)
 {
-  osalMemHdr_t *hdr = (osalMemHdr_t *)ptr - 1;
-  halIntState_t intState;
+  (*steps)++;
 
-#ifdef DPRINTF_OSALHEAPTRACE
-  printf("osal_mem_free(%lx):%s:%u\n", (unsigned) ptr, fname, lnum);
-#endif /* DPRINTF_OSALHEAPTRACE */
+#if ( OSALMEM_CS_STATS )
+  if ( memCs.stepMax < *steps )
+  {
+    memCs.stepMax = *steps;
+  }
+#endif
 
-  HAL_ASSERT(((uint8_t *)ptr >= (uint8_t *)theHeap) && ((uint8_t *)ptr < (uint8_t *)theHeap+MAXMEMHEAP));
-  HAL_ASSERT(hdr->hdr.inUse);
+  if ( (*steps < OSALMEM_CS_STEPS) || (*retry > OSALMEM_CS_RETRY) )
+  {
+    return FALSE;
+  }
+
+  *steps = 0;
+
+  OSALMEM_EXIT_CS( *intState );   // Re-enable interrupts.
+  OSALMEM_ENTER_CS( *intState );  // Hold off interrupts.
+
+  if ( *gen == osalMemGen )
+  {
+    return FALSE;
+  }
+
+#if ( OSALMEM_CS_STATS )
+  memCs.restarts++;
+  if ( *retry == OSALMEM_CS_RETRY )
+  {
+    memCs.locked++;
+  }
+#endif
+  (*retry)++;
+  *gen = osalMemGen;
+
+  return TRUE;
+}
 
-  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+/**************************************************************************************************
+ * @fn          osalMemRelease
+ *
+ * @brief       Return an allocated block to the heap. The heap must be locked.
+ *
+ * input parameters
+ *
+ * @param hdr - header of the block.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+static void osalMemRelease(osalMemHdr_t *hdr)
+{
+  // Freeing changes neither the block layout nor a block a suspended search may coalesce into,
+  // so it does not bump 'osalMemGen'.
   hdr->hdr.inUse = FALSE;
 
   if (ff1 > hdr)
@@ -501,28 +708,1050 @@ void osal_mem_free(void *ptr)
   if (osalMemStat != 0)  // Don't profile until after the LL block is filled.
 #endif
   {
-    uint8_t idx;
+    proCur[osalMemProIdx(hdr->hdr.len)]--;
+  }
+#endif
+#if OSALMEM_METRICS
+  memAlo -= hdr->hdr.len;
+  blkFree++;
+#endif
+}
+
+#if OSALMEM_CTX_CACHE
+/**************************************************************************************************
+ * @fn          osalMemCacheAlloc
+ *
+ * @brief       Serve an allocation from the cache of the calling context. An empty cache is
+ *              refilled with a batch of blocks taken from the shared heap under one lock.
+ *
+ * input parameters
+ *
+ * @param size - total block size, including the header.
+ *
+ * output parameters
+ *
+ * @param blk - header of the allocated block, NULL if the shared heap is exhausted.
+ *
+ * @return      TRUE if the allocation was handled, FALSE if the size or context is not cached.
+ */
+static uint8_t osalMemCacheAlloc(uint16_t size, osalMemHdr_t **blk)
+{
+  osalMemCache_t *cache;
+  osalMemHdr_t *hdr;
+  osalMemHdr_t *tmp;
+  halIntState_t intState;
+  uint8_t ctx, cls, cnt;
+
+  if ((osalMemStat == 0) || (size < OSALMEM_CACHE_MIN) || (size > OSALMEM_SMALL_BLKSZ) ||
+      ((ctx = OSAL_Context_Hook()) >= OSALMEM_CTX_CNT))
+  {
+    return FALSE;
+  }
+
+  cache = memCache + ctx;
+  cls = OSALMEM_CACHE_CLASS(size);
+
+  if (cache->list[cls] == 0)
+  {
+    OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+    hdr = osalMemFind(size, &intState);
+
+    for (cnt = 1; (hdr != NULL) && (cnt < OSALMEM_CACHE_BATCH); cnt++)
+    {
+      if ((tmp = osalMemFind(size, &intState)) == NULL)
+      {
+        break;
+      }
+
+      // A block that was too small to split belongs to another size.
+      if (tmp->hdr.len != size)
+      {
+        osalMemRelease(tmp);
+        break;
+      }
+
+      OSALMEM_CACHE_LINK(tmp) = cache->list[cls];
+      cache->list[cls] = (uint16_t)(tmp - theHeap) + 1;
+      cache->cnt[cls]++;
+      cache->stats.cached++;
+    }
+
+    OSALMEM_EXIT_CS( intState );  // Re-enable interrupts.
+
+    cache->stats.refills++;
+  }
+  else
+  {
+    hdr = theHeap + cache->list[cls] - 1;
+    cache->list[cls] = OSALMEM_CACHE_LINK(hdr);
+    cache->cnt[cls]--;
+    cache->stats.cached--;
+    cache->stats.hits++;
+  }
+
+  *blk = hdr;
+  return TRUE;
+}
+
+/**************************************************************************************************
+ * @fn          osalMemCacheFree
+ *
+ * @brief       Keep a freed block in the cache of the calling context. A full cache first returns
+ *              a batch of blocks to the shared heap under one lock.
+ *
+ * input parameters
+ *
+ * @param hdr - header of the block.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      TRUE if the block was cached, FALSE if the size or context is not cached.
+ */
+static uint8_t osalMemCacheFree(osalMemHdr_t *hdr)
+{
+  osalMemCache_t *cache;
+  osalMemHdr_t *tmp;
+  halIntState_t intState;
+  uint8_t ctx, cls, cnt;
+
+  if ((osalMemStat == 0) || (hdr->hdr.len < OSALMEM_CACHE_MIN) ||
+      (hdr->hdr.len > OSALMEM_SMALL_BLKSZ) ||
+      ((ctx = OSAL_Context_Hook()) >= OSALMEM_CTX_CNT))
+  {
+    return FALSE;
+  }
+
+  cache = memCache + ctx;
+  cls = OSALMEM_CACHE_CLASS(hdr->hdr.len);
+
+  if (cache->cnt[cls] == OSALMEM_CACHE_DEPTH)
+  {
+    OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+    for (cnt = 0; cnt < OSALMEM_CACHE_BATCH; cnt++)
+    {
+      tmp = theHeap + cache->list[cls] - 1;
+      cache->list[cls] = OSALMEM_CACHE_LINK(tmp);
+      osalMemRelease(tmp);
+    }
+
+    OSALMEM_EXIT_CS( intState );  // Re-enable interrupts.
+
+    cache->cnt[cls] -= OSALMEM_CACHE_BATCH;
+    cache->stats.cached -= OSALMEM_CACHE_BATCH;
+    cache->stats.flushes++;
+  }
+
+  OSALMEM_CACHE_LINK(hdr) = cache->list[cls];
+  cache->list[cls] = (uint16_t)(hdr - theHeap) + 1;
+  cache->cnt[cls]++;
+  cache->stats.cached++;
+
+  return TRUE;
+}
+#endif
+
+/* ------------------------------------------------------------------------------------------------
+ *                                           Global Variables
+ * ------------------------------------------------------------------------------------------------
+ */
+
+/**************************************************************************************************
+ * @fn          osal_mem_init
+ *
+ * @brief       This function is the OSAL heap memory management initialization callback.
+ *
+ * input parameters
+ *
+ * None.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+void osal_mem_init(void)
+{
+  HAL_ASSERT(((OSALMEM_MIN_BLKSZ % OSALMEM_HDRSZ) == 0));
+  HAL_ASSERT(((OSALMEM_LL_BLKSZ % OSALMEM_HDRSZ) == 0));
+  HAL_ASSERT(((OSALMEM_SMALL_BLKSZ % OSALMEM_HDRSZ) == 0));
+
+#if OSALMEM_PROFILER
+  (void)osal_memset(theHeap, OSALMEM_INIT, MAXMEMHEAP);
+#endif
+
+  // Setup a NULL block at the end of the heap for fast comparisons with zero.
+  theHeap[OSALMEM_LASTBLK_IDX].val = 0;
+
+  // Setup the small-block bucket.
+  ff1 = theHeap;
+  ff1->val = OSALMEM_SMALLBLK_BUCKET;                   // Set 'len' & clear 'inUse' field.
+  // Set 'len' & 'inUse' fields - this is a 'zero data bytes' lifetime allocation to block the
+  // small-block bucket from ever being coalesced with the wilderness.
+  theHeap[OSALMEM_SMALLBLK_HDRCNT].val = (OSALMEM_HDRSZ | OSALMEM_IN_USE);
+
+  // Setup the wilderness.
+  theHeap[OSALMEM_BIGBLK_IDX].val = OSALMEM_BIGBLK_SZ;  // Set 'len' & clear 'inUse' field.
+
+#if ( OSALMEM_METRICS )
+  /* Start with the small-block bucket and the wilderness - don't count the
+   * end-of-heap NULL block nor the end-of-small-block NULL block.
+   */
+  blkCnt = blkFree = 2;
+#endif
+}
+
+/**************************************************************************************************
+ * @fn          osal_mem_kick
+ *
+ * @brief       This function is the OSAL task initialization callback.
+ * @brief       Kick the ff1 pointer out past the long-lived OSAL Task blocks.
+ *              Invoke this once after all long-lived blocks have been allocated -
+ *              presently at the end of osal_init_system().
+ *
+ * input parameters
+ *
+ * None.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+void osal_mem_kick(void)
+{
+  halIntState_t intState;
+  osalMemHdr_t *tmp = osal_mem_alloc(1);
+
+  HAL_ASSERT((tmp != NULL));
+  OSALMEM_ENTER_CS(intState);  // Hold off interrupts.
+
+  /* All long-lived allocations have filled the LL block reserved in the small-block bucket.
+   * Set 'osalMemStat' so searching for memory in this bucket from here onward will only be done
+   * for sizes meeting the OSALMEM_SMALL_BLKSZ criteria.
+   */
+  ff1 = tmp - 1;       // Set 'ff1' to point to the first available memory after the LL block.
+  osal_mem_free(tmp);
+  osalMemStat = 0x01;  // Set 'osalMemStat' after the free because it enables memory profiling.
+
+  OSALMEM_EXIT_CS(intState);  // Re-enable interrupts.
+}
+
+/**************************************************************************************************
+ * @fn          osal_mem_alloc
+ *
+ * @brief       This function implements the OSAL dynamic memory allocation functionality.
+ *
+ * input parameters
+ *
+ * @param size - the number of bytes to allocate from the HEAP.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+#if ( OSALMEM_CALL_SITE )
+void *osal_mem_alloc_dbg( uint16_t size, const char *fname, unsigned lnum )
+#else /* OSALMEM_CALL_SITE */
+void *osal_mem_alloc( uint16_t size )
+#endif /* OSALMEM_CALL_SITE */
+{
+  osalMemHdr_t *hdr;
+  halIntState_t intState;
+#if ( OSALMEM_TRACE )
+  const uint16_t reqSize = size;
+#endif
+
+  size = osalMemBlkSize(size);
+
+#if ( OSALMEM_CTX_CACHE )
+  if ( osalMemCacheAlloc(size, &hdr) )
+  {
+#if ( OSALMEM_TRACE )
+    OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+    osalMemTraceAdd(OSALMEM_TRACE_ALLOC, reqSize, hdr, fname, lnum);
+    OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+#endif
+  }
+  else
+#endif
+  {
+    OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+    hdr = osalMemFind(size, &intState);
+
+#if ( OSALMEM_TRACE )
+    osalMemTraceAdd(OSALMEM_TRACE_ALLOC, reqSize, hdr, fname, lnum);
+#endif
+
+    OSALMEM_EXIT_CS( intState );  // Re-enable interrupts.
+  }
+
+  if ( hdr != NULL )
+  {
+    hdr++;
+  }
+
+  HAL_ASSERT(((size_t)hdr % sizeof(halDataAlign_t)) == 0);
+
+#if ( OSALMEM_PROFILER )
+  // The block is owned now, so it is filled with interrupts enabled.
+  if ( hdr != NULL )
+  {
+    (void)osal_memset((uint8_t *)hdr, OSALMEM_ALOC, ((hdr - 1)->hdr.len - OSALMEM_HDRSZ));
+  }
+#endif
+
+#ifdef DPRINTF_OSALHEAPTRACE
+  printf("osal_mem_alloc(%u)->%lx:%s:%u\n", size, (unsigned) hdr, fname, lnum);
+#endif /* DPRINTF_OSALHEAPTRACE */
+  return (void *)hdr;
+}
+
+/**************************************************************************************************
+ * @fn          osal_mem_free
+ *
+ * @brief       This function implements the OSAL dynamic memory de-allocation functionality.
+ *
+ * input parameters
+ *
+ * @param ptr - A valid pointer (i.e. a pointer returned by osal_mem_alloc()) to the memory to free.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+#if ( OSALMEM_CALL_SITE )
+void osal_mem_free_dbg(void *ptr, const char *fname, unsigned lnum)
+#else /* OSALMEM_CALL_SITE */
+void osal_mem_free(void *ptr)
+#endif /* OSALMEM_CALL_SITE */
+{
+  osalMemHdr_t *hdr = (osalMemHdr_t *)ptr - 1;
+  halIntState_t intState;
+
+#ifdef DPRINTF_OSALHEAPTRACE
+  printf("osal_mem_free(%lx):%s:%u\n", (unsigned) ptr, fname, lnum);
+#endif /* DPRINTF_OSALHEAPTRACE */
+
+  HAL_ASSERT(((uint8_t *)ptr >= (uint8_t *)theHeap) && ((uint8_t *)ptr < (uint8_t *)theHeap+MAXMEMHEAP));
+  HAL_ASSERT(hdr->hdr.inUse);
+
+#if OSALMEM_PROFILER
+  // The block is still owned until it is marked free, so it is filled with interrupts enabled.
+  (void)osal_memset((uint8_t *)(hdr+1), OSALMEM_REIN, (hdr->hdr.len - OSALMEM_HDRSZ) );
+#endif
+
+#if OSALMEM_CTX_CACHE
+  if ( osalMemCacheFree(hdr) )
+  {
+#if OSALMEM_TRACE
+    OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+    osalMemTraceAdd(OSALMEM_TRACE_FREE, hdr->hdr.len, hdr, fname, lnum);
+    OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+#endif
+    return;
+  }
+#endif
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+  osalMemRelease(hdr);
+#if OSALMEM_TRACE
+  osalMemTraceAdd(OSALMEM_TRACE_FREE, hdr->hdr.len, hdr, fname, lnum);
+#endif
+  OSALMEM_EXIT_CS( intState );  // Re-enable interrupts.
+}
+
+/**************************************************************************************************
+ * @fn          osal_mem_realloc
+ *
+ * @brief       This function resizes a block of OSAL dynamic memory. The block is shrunk in place
+ *              by splitting off its tail, or grown in place by absorbing the free blocks that
+ *              follow it. Only when neither is possible is a new block allocated, the data copied
+ *              and the old block freed.
+ *
+ * input parameters
+ *
+ * @param ptr - A pointer returned by osal_mem_alloc() or osal_mem_realloc(), or NULL to allocate.
+ * @param size - The new number of bytes, or 0 to free the block.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      Pointer to the resized block, NULL if it could not be resized (the original block
+ *              is then left untouched) or if 'size' is 0.
+ */
+#if ( OSALMEM_CALL_SITE )
+void *osal_mem_realloc_dbg( void *ptr, uint16_t size, const char *fname, unsigned lnum )
+#else /* OSALMEM_CALL_SITE */
+void *osal_mem_realloc( void *ptr, uint16_t size )
+#endif /* OSALMEM_CALL_SITE */
+{
+  osalMemHdr_t *hdr = (osalMemHdr_t *)ptr - 1;
+  osalMemHdr_t *next;
+  halIntState_t intState;
+  uint16_t need, have, len;
+  uint8_t absorbed = 0;
+  void *newPtr;
+
+  if ( ptr == NULL )
+  {
+#if ( OSALMEM_CALL_SITE )
+    return osal_mem_alloc_dbg(size, fname, lnum);
+#else
+    return osal_mem_alloc(size);
+#endif
+  }
+
+  if ( size == 0 )
+  {
+#if ( OSALMEM_CALL_SITE )
+    osal_mem_free_dbg(ptr, fname, lnum);
+#else
+    osal_mem_free(ptr);
+#endif
+    return NULL;
+  }
+
+  HAL_ASSERT(((uint8_t *)ptr >= (uint8_t *)theHeap) && ((uint8_t *)ptr < (uint8_t *)theHeap+MAXMEMHEAP));
+  HAL_ASSERT(hdr->hdr.inUse);
+
+  need = osalMemBlkSize(size);
+  len = hdr->hdr.len;
+
+#if OSALMEM_PROFILER
+  // The tail split off by a shrink is still owned here, so it is filled with interrupts enabled.
+  if ( (need < len) && ((uint16_t)(len - need) >= OSALMEM_MIN_BLKSZ) )
+  {
+    (void)osal_memset((uint8_t *)hdr + need + OSALMEM_HDRSZ, OSALMEM_REIN, (len - need - OSALMEM_HDRSZ));
+  }
+#endif
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+  have = len;
+  next = (osalMemHdr_t *)((uint8_t *)hdr + len);
+
+  // Never grow a block of the small-block bucket beyond the small block size.
+  if ( (need > len) && ((osalMemStat == 0) || (need <= OSALMEM_SMALL_BLKSZ) ||
+                        (hdr >= (theHeap + OSALMEM_BIGBLK_IDX))) )
+  {
+    // Add up the free blocks that follow until the request is met, bounded like a search step.
+    while ( (have < need) && (next->val != 0) && !next->hdr.inUse && (absorbed < OSALMEM_CS_STEPS) )
+    {
+      have += next->hdr.len;
+      next = (osalMemHdr_t *)((uint8_t *)next + next->hdr.len);
+      absorbed++;
+    }
+  }
+
+  if ( have >= need )
+  {
+    uint16_t tmp = have - need;
+
+#if OSALMEM_PROFILER
+#if !OSALMEM_PROFILER_LL
+    if (osalMemStat != 0)  // Don't profile until after the LL block is filled.
+#endif
+    {
+      proCur[osalMemProIdx(len)]--;
+    }
+#endif
+#if OSALMEM_METRICS
+    blkCnt -= absorbed;
+    blkFree -= absorbed;
+#endif
+
+    // Determine whether the threshold for splitting off the tail is met.
+    if ( tmp >= OSALMEM_MIN_BLKSZ )
+    {
+      next = (osalMemHdr_t *)((uint8_t *)hdr + need);
+      next->val = tmp;                     // Set 'len' & clear 'inUse' field.
+      hdr->val = (need | OSALMEM_IN_USE);  // Set 'len' & 'inUse' field.
+
+#if OSALMEM_METRICS
+      blkCnt++;
+      blkFree++;
+      if ( blkMax < blkCnt )
+      {
+        blkMax = blkCnt;
+      }
+#endif
+    }
+    else
+    {
+      hdr->val = (have | OSALMEM_IN_USE);  // Set 'len' & 'inUse' field.
+    }
+
+    osalMemGen++;
+
+#if OSALMEM_METRICS
+    memAlo = memAlo - len + hdr->hdr.len;
+    if ( memMax < memAlo )
+    {
+      memMax = memAlo;
+    }
+#endif
+#if OSALMEM_PROFILER
+#if !OSALMEM_PROFILER_LL
+    if (osalMemStat != 0)  // Don't profile until after the LL block is filled.
+#endif
+    {
+      uint8_t idx = osalMemProIdx(hdr->hdr.len);
+
+      proCur[idx]++;
+      if ( proMax[idx] < proCur[idx] )
+      {
+        proMax[idx] = proCur[idx];
+      }
+    }
+#endif
+
+    // 'ff1' may have pointed into an absorbed block, or a free tail was split off before it.
+    next = (osalMemHdr_t *)((uint8_t *)hdr + hdr->hdr.len);
+    if ( ((ff1 > hdr) && (ff1 < next)) || ((tmp >= OSALMEM_MIN_BLKSZ) && (ff1 > next)) )
+    {
+      ff1 = next;
+    }
+
+#if ( OSALMEM_TRACE )
+    osalMemTraceAdd(OSALMEM_TRACE_REALLOC, size, hdr, fname, lnum);
+#endif
+
+    OSALMEM_EXIT_CS( intState );  // Re-enable interrupts.
+
+#if OSALMEM_PROFILER
+    if ( hdr->hdr.len > len )
+    {
+      (void)osal_memset((uint8_t *)hdr + len, OSALMEM_ALOC, (hdr->hdr.len - len));
+    }
+#endif
+
+#ifdef DPRINTF_OSALHEAPTRACE
+    printf("osal_mem_realloc(%lx,%u)->%lx:%s:%u\n", (unsigned) ptr, size, (unsigned) ptr, fname, lnum);
+#endif /* DPRINTF_OSALHEAPTRACE */
+    return ptr;
+  }
+
+  OSALMEM_EXIT_CS( intState );  // Re-enable interrupts.
+
+  // Neither shrinking nor growing in place is possible - move the data.
+#if ( OSALMEM_CALL_SITE )
+  newPtr = osal_mem_alloc_dbg(size, fname, lnum);
+#else
+  newPtr = osal_mem_alloc(size);
+#endif
+
+  if ( newPtr != NULL )
+  {
+    (void)osal_memcpy(newPtr, ptr, (len - OSALMEM_HDRSZ));
+
+#if ( OSALMEM_CALL_SITE )
+    osal_mem_free_dbg(ptr, fname, lnum);
+#else
+    osal_mem_free(ptr);
+#endif
+  }
+
+  return newPtr;
+}
+
+/*********************************************************************
+ * @fn      osal_arena_init
+ *
+ * @brief   Carve an arena region from the heap. This is the only heap
+ *          operation of an arena, all later allocations are served from
+ *          the region without walking the heap or locking interrupts.
+ *
+ * @param   arena - arena to initialize
+ * @param   size - size of the region in bytes
+ *
+ * @return  OSAL_SUCCESS, or OSAL_FAILURE if the heap is exhausted
+ */
+uint8_t osal_arena_init( osalArena_t *arena, uint16_t size )
+{
+  arena->base = osal_mem_alloc( size );
+  arena->size = (arena->base != NULL) ? size : 0;
+  arena->used = 0;
+  arena->peak = 0;
+  arena->fail = 0;
+
+  return ( (arena->base != NULL) ? OSAL_SUCCESS : OSAL_FAILURE );
+}
+
+/*********************************************************************
+ * @fn      osal_arena_alloc
+ *
+ * @brief   Bump allocate from an arena in O(1). The memory is valid
+ *          until the next osal_arena_reset() and must not be freed
+ *          with osal_mem_free().
+ *
+ * @param   arena - arena to allocate from
+ * @param   size - number of bytes
+ *
+ * @return  pointer aligned to halDataAlign_t, NULL if it does not fit
+ */
+void *osal_arena_alloc( osalArena_t *arena, uint16_t size )
+{
+  uint8_t *ptr;
+  uint16_t len = (uint16_t)(((size + sizeof( halDataAlign_t ) - 1) / sizeof( halDataAlign_t )) *
+                            sizeof( halDataAlign_t ));
+
+  if ( (len < size) || (len > (arena->size - arena->used)) )
+  {
+    arena->fail++;
+    return NULL;
+  }
+
+  ptr = arena->base + arena->used;
+  arena->used += len;
+
+  if ( arena->peak < arena->used )
+  {
+    arena->peak = arena->used;
+  }
+
+  return ptr;
+}
+
+/*********************************************************************
+ * @fn      osal_arena_reset
+ *
+ * @brief   Release everything allocated from an arena.
+ *
+ * @param   arena - arena to reset
+ *
+ * @return  none
+ */
+void osal_arena_reset( osalArena_t *arena )
+{
+  arena->used = 0;
+}
+
+/*********************************************************************
+ * @fn      osal_arena_destroy
+ *
+ * @brief   Return an arena region to the heap.
+ *
+ * @param   arena - arena to destroy
+ *
+ * @return  none
+ */
+void osal_arena_destroy( osalArena_t *arena )
+{
+  if ( arena->base != NULL )
+  {
+    osal_mem_free( arena->base );
+    arena->base = NULL;
+  }
+
+  arena->size = 0;
+  arena->used = 0;
+}
+
+#if OSALMEM_CTX_CACHE
+/*********************************************************************
+ * @fn      osal_mem_cache_stats
+ *
+ * @brief   Copy the statistics of a context's block cache.
+ *
+ * @param   ctx - context id as returned by OSAL_Context_Hook()
+ * @param   stats - buffer for the statistics
+ *
+ * @return  OSAL_SUCCESS, or INVALIDPARAMETER if the context has no cache
+ */
+uint8_t osal_mem_cache_stats( uint8_t ctx, osalMemCacheStats_t *stats )
+{
+  if ( ctx >= OSALMEM_CTX_CNT )
+  {
+    return ( INVALIDPARAMETER );
+  }
+
+  *stats = memCache[ctx].stats;
+
+  return ( OSAL_SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_cache_flush
+ *
+ * @brief   Return all blocks cached by the calling context to the
+ *          shared heap, e.g. before the heap metrics are inspected.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osal_mem_cache_flush( void )
+{
+  halIntState_t intState;
+  osalMemCache_t *cache;
+  osalMemHdr_t *hdr;
+  uint8_t ctx, cls;
+
+  if ( (ctx = OSAL_Context_Hook()) >= OSALMEM_CTX_CNT )
+  {
+    return;
+  }
+
+  cache = memCache + ctx;
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+  for ( cls = 0; cls < OSALMEM_CACHE_CLASSES; cls++ )
+  {
+    while ( cache->list[cls] != 0 )
+    {
+      hdr = theHeap + cache->list[cls] - 1;
+      cache->list[cls] = OSALMEM_CACHE_LINK( hdr );
+      osalMemRelease( hdr );
+    }
+
+    cache->cnt[cls] = 0;
+  }
+
+  cache->stats.cached = 0;
+
+  OSALMEM_EXIT_CS( intState );  // Re-enable interrupts.
+}
+#endif
+
+#if OSALMEM_HANDLES
+/*********************************************************************
+ * @fn      osal_mem_halloc
+ *
+ * @brief   Allocate a movable block. The block may be moved by the
+ *          compactor whenever it is not locked, so its address is only
+ *          obtained, and only valid, between osal_mem_lock() and
+ *          osal_mem_unlock().
+ *
+ * @param   size - the number of bytes to allocate
+ *
+ * @return  handle of the block, OSALMEM_NO_HANDLE if either the heap or
+ *          the handle table is exhausted
+ */
+osalMemHandle_t osal_mem_halloc( uint16_t size )
+{
+  halIntState_t intState;
+  void *ptr;
+  uint8_t idx;
+
+  ptr = osal_mem_alloc( size );
+  if ( ptr == NULL )
+  {
+    return ( OSALMEM_NO_HANDLE );
+  }
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+  for ( idx = 0; idx < OSALMEM_HANDLE_CNT; idx++ )
+  {
+    if ( memHdl[idx].hdr == NULL )
+    {
+      memHdl[idx].hdr = (osalMemHdr_t *)ptr - 1;
+      memHdl[idx].lockCnt = 0;
+      break;
+    }
+  }
+
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+
+  if ( idx == OSALMEM_HANDLE_CNT )
+  {
+    osal_mem_free( ptr );
+    return ( OSALMEM_NO_HANDLE );
+  }
+
+  return ( idx + 1 );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_lock
+ *
+ * @brief   Pin a movable block so that the compactor leaves it in place.
+ *          Locks nest, each one must be released by osal_mem_unlock().
+ *
+ * @param   handle - handle returned by osal_mem_halloc()
+ *
+ * @return  current address of the block
+ */
+void *osal_mem_lock( osalMemHandle_t handle )
+{
+  osalMemHdl_t *hdl = memHdl + handle - 1;
+  halIntState_t intState;
+  void *ptr;
+
+  HAL_ASSERT( (handle != OSALMEM_NO_HANDLE) && (handle <= OSALMEM_HANDLE_CNT) );
+  HAL_ASSERT( hdl->hdr != NULL );
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+  hdl->lockCnt++;
+  ptr = hdl->hdr + 1;
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+
+  return ( ptr );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_unlock
+ *
+ * @brief   Release a pin taken by osal_mem_lock(). Once the last pin is
+ *          released, pointers to the block must no longer be used.
+ *
+ * @param   handle - handle returned by osal_mem_halloc()
+ *
+ * @return  none
+ */
+void osal_mem_unlock( osalMemHandle_t handle )
+{
+  osalMemHdl_t *hdl = memHdl + handle - 1;
+  halIntState_t intState;
+
+  HAL_ASSERT( (handle != OSALMEM_NO_HANDLE) && (handle <= OSALMEM_HANDLE_CNT) );
+  HAL_ASSERT( hdl->lockCnt != 0 );
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+  hdl->lockCnt--;
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+}
+
+/*********************************************************************
+ * @fn      osal_mem_hfree
+ *
+ * @brief   Free a movable block and its handle.
+ *
+ * @param   handle - handle returned by osal_mem_halloc()
+ *
+ * @return  none
+ */
+void osal_mem_hfree( osalMemHandle_t handle )
+{
+  osalMemHdl_t *hdl = memHdl + handle - 1;
+  halIntState_t intState;
+  osalMemHdr_t *hdr;
+
+  HAL_ASSERT( (handle != OSALMEM_NO_HANDLE) && (handle <= OSALMEM_HANDLE_CNT) );
+  HAL_ASSERT( hdl->hdr != NULL );
+
+  // Once out of the table the block is no longer moved, so it can be freed like any other.
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+  hdr = hdl->hdr;
+  hdl->hdr = NULL;
+  hdl->lockCnt = 0;
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+
+  osal_mem_free( hdr + 1 );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_compact
+ *
+ * @brief   Incrementally compact the heap. The heap is walked from its
+ *          start, runs of free blocks are merged, and an unlocked movable
+ *          block that follows a free block is slid down into it so that
+ *          the free space bubbles up towards the following free blocks.
+ *          A pass is spread over as many calls as needed; interrupts are
+ *          held off for at most OSALMEM_CS_STEPS headers or one move.
+ *          The fragmentation of the heap is gathered along the way.
+ *
+ * @param   maxMoves - the number of blocks to move before returning
+ *
+ * @return  the number of blocks moved
+ */
+uint8_t osal_mem_compact( uint8_t maxMoves )
+{
+  halIntState_t intState;
+  osalMemHdr_t *hdr;
+  osalMemHdr_t *next;
+  uint16_t steps = 0;
+  uint8_t retry = 0;
+  uint8_t moves = 0;
+  uint8_t idx;
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+  // Blocks may have been split or merged since the walk stopped - start over.
+  if ( (memCompactPos == NULL) || (memCompactGen != osalMemGen) )
+  {
+    if ( memCompactPos == NULL )
+    {
+      memCompact.fragBefore = memCompact.fragAfter;
+    }
+    memCompactPos = theHeap;
+    memCompactGen = osalMemGen;
+    (void)osal_memset( &memCompactFrag, 0, sizeof( memCompactFrag ) );
+    memCompactRun = 0;
+  }
+
+  hdr = memCompactPos;
+
+  while ( hdr->val != 0 )
+  {
+    next = (osalMemHdr_t *)((uint8_t *)hdr + hdr->hdr.len);
+
+    if ( !hdr->hdr.inUse && (next->val != 0) )
+    {
+      if ( !next->hdr.inUse )
+      {
+        hdr->hdr.len += next->hdr.len;
+        memCompactGen = ++osalMemGen;
+#if ( OSALMEM_METRICS )
+        blkCnt--;
+        blkFree--;
+#endif
+        next = hdr;
+      }
+      else
+      {
+        for ( idx = 0; idx < OSALMEM_HANDLE_CNT; idx++ )
+        {
+          if ( memHdl[idx].hdr == next )
+          {
+            break;
+          }
+        }
+
+        if ( (idx < OSALMEM_HANDLE_CNT) && (memHdl[idx].lockCnt == 0) )
+        {
+          const uint16_t freeLen = hdr->hdr.len;
+          const uint16_t blkLen = next->hdr.len;
+          osalMemHdr_t *end = (osalMemHdr_t *)((uint8_t *)next + blkLen);
+          osalMemHdr_t *dst = hdr;
+          osalMemHdr_t *src = next;
+
+          // Copy upwards, the regions overlap when the block is larger than the free space.
+          while ( src < end )
+          {
+            *dst++ = *src++;
+          }
+
+          memHdl[idx].hdr = hdr;
+          next = dst;
+          next->val = freeLen;  // Set 'len' & clear 'inUse' field.
+#if ( OSALMEM_PROFILER )
+          (void)osal_memset( (uint8_t *)(next+1), OSALMEM_REIN, (freeLen - OSALMEM_HDRSZ) );
+#endif
+
+          // 'ff1' may have pointed into the free space or the moved block.
+          if ( (ff1 >= hdr) && (ff1 < end) )
+          {
+            ff1 = next;
+          }
+
+          memCompactGen = ++osalMemGen;
+          memCompact.moves++;
+          memCompact.bytesMoved += blkLen;
+
+          if ( ++moves == maxMoves )
+          {
+            memCompactRun = 0;  // Leaving the moved block behind.
+            hdr = next;
+            break;
+          }
+
+          // One move per critical section.
+          steps = OSALMEM_CS_STEPS;
+        }
+      }
+    }
+
+    // Gather the fragmentation indices of the pass from the blocks it leaves behind.
+    if ( next != hdr )
+    {
+      if ( hdr->hdr.inUse )
+      {
+        memCompactRun = 0;
+      }
+      else
+      {
+        if ( memCompactRun == 0 )
+        {
+          memCompactFrag.freeRuns++;
+        }
+        memCompactRun += hdr->hdr.len;
+        memCompactFrag.freeMem += hdr->hdr.len;
+
+        if ( memCompactFrag.maxRun < memCompactRun )
+        {
+          memCompactFrag.maxRun = memCompactRun;
+        }
+      }
+    }
+
+    hdr = next;
 
-    for (idx = 0; idx < OSALMEM_PROMAX; idx++)
+    if ( ++steps >= OSALMEM_CS_STEPS )
     {
-      if (hdr->hdr.len <= proCnt[idx])
+      steps = 0;
+
+      OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+      OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+      if ( memCompactGen != osalMemGen )
       {
-        break;
+        hdr = theHeap;
+        memCompactGen = osalMemGen;
+        (void)osal_memset( &memCompactFrag, 0, sizeof( memCompactFrag ) );
+        memCompactRun = 0;
+
+        // Leave the rest of the pass to a later call when the heap is busy.
+        if ( retry++ == OSALMEM_CS_RETRY )
+        {
+          break;
+        }
       }
     }
+  }
+
+  memCompactPos = (hdr->val != 0) ? hdr : NULL;
+  if ( memCompactPos == NULL )
+  {
+    memCompact.passes++;
 
-    proCur[idx]--;
+    if ( memCompactFrag.freeMem != 0 )
+    {
+      memCompact.fragAfter = 100 - (uint8_t)(((uint32_t)memCompactFrag.maxRun * 100) /
+                                             memCompactFrag.freeMem);
+    }
+    else
+    {
+      memCompact.fragAfter = 0;
+    }
   }
 
-  (void)osal_memset((uint8_t *)(hdr+1), OSALMEM_REIN, (hdr->hdr.len - OSALMEM_HDRSZ) );
-#endif
-#if OSALMEM_METRICS
-  memAlo -= hdr->hdr.len;
-  blkFree++;
-#endif
+  OSALMEM_EXIT_CS( intState );  // Re-enable interrupts.
+
+  return ( moves );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_compact_stats
+ *
+ * @brief   Copy the heap compaction statistics.
+ *
+ * @param   stats - buffer for the statistics
+ *
+ * @return  none
+ */
+void osal_mem_compact_stats( osalMemCompactStats_t *stats )
+{
+  halIntState_t intState;
 
-  HAL_EXIT_CRITICAL_SECTION( intState );  // Re-enable interrupts.
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+  *stats = memCompact;
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
 }
+#endif
 
 #if OSALMEM_METRICS
 /*********************************************************************
@@ -600,5 +1829,451 @@ uint16_t osal_heap_high_water( void )
 #endif
 }
 
+#if OSALMEM_METRICS
+/*********************************************************************
+ * @fn      osal_mem_metrics
+ *
+ * @brief   Copy all heap metrics and, when the profiler is enabled,
+ *          the profiling buckets in one consistent snapshot.
+ *
+ * @param   metrics - buffer for the metrics
+ *
+ * @return  none
+ */
+void osal_mem_metrics( osalMemMetrics_t *metrics )
+{
+  halIntState_t intState;
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+  metrics->blkMax = blkMax;
+  metrics->blkCnt = blkCnt;
+  metrics->blkFree = blkFree;
+  metrics->memAlo = memAlo;
+  metrics->memMax = memMax;
+#if OSALMEM_PROFILER
+  (void)osal_memcpy( metrics->proCnt, proCnt, sizeof( proCnt ) );
+  (void)osal_memcpy( metrics->proCur, proCur, sizeof( proCur ) );
+  (void)osal_memcpy( metrics->proMax, proMax, sizeof( proMax ) );
+  (void)osal_memcpy( metrics->proTot, proTot, sizeof( proTot ) );
+  metrics->proSmallBlkMiss = proSmallBlkMiss;
+#endif
+
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+}
+#endif
+
+/*********************************************************************
+ * @fn      osal_mem_walk
+ *
+ * @brief   Heap walk iterator. Reports the block following the one in
+ *          'blk', or the first block of the heap when 'blk->len' is 0.
+ *          The small-block bucket terminator is reported as an in-use
+ *          block without data bytes. Each step holds off interrupts on
+ *          its own, so if blocks were split or merged since 'blk' was
+ *          reported, the walk stops with 'blk->len' cleared and has to
+ *          be started over.
+ *
+ * @param   blk - previous block on input, next block on output
+ *
+ * @return  TRUE if a block was reported, FALSE at the end of the heap
+ *          or when the heap changed
+ */
+uint8_t osal_mem_walk( osalMemBlk_t *blk )
+{
+  halIntState_t intState;
+  osalMemHdr_t *hdr;
+  uint8_t rtrn = FALSE;
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+  if ( blk->len == 0 )
+  {
+    blk->offset = 0;
+    blk->gen = osalMemGen;
+  }
+  else
+  {
+    blk->offset += blk->len;
+  }
+
+  hdr = (osalMemHdr_t *)((uint8_t *)theHeap + blk->offset);
+  if ( blk->gen != osalMemGen )
+  {
+    // The previous block may no longer end where it did.
+    blk->len = 0;
+  }
+  else if ( (blk->offset < MAXMEMHEAP) && (hdr->val != 0) )
+  {
+    blk->len = hdr->hdr.len;
+    blk->inUse = hdr->hdr.inUse;
+    rtrn = TRUE;
+  }
+
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+
+  return ( rtrn );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_frag
+ *
+ * @brief   Compute the heap fragmentation indices. Adjacent free blocks
+ *          that have not yet been coalesced by osal_mem_alloc() count
+ *          as one run, since they can satisfy a single allocation.
+ *          Interrupts are let in every OSALMEM_CS_STEPS headers, blocks
+ *          freed meanwhile may or may not be counted as free.
+ *
+ * @param   frag - buffer for the fragmentation indices
+ *
+ * @return  none
+ */
+void osal_mem_frag( osalMemFrag_t *frag )
+{
+  halIntState_t intState;
+  osalMemHdr_t *hdr = theHeap;
+  uint16_t run = 0;
+  uint16_t steps = 0;
+  uint16_t gen;
+  uint8_t retry = 0;
+
+  frag->freeMem = 0;
+  frag->freeRuns = 0;
+  frag->maxRun = 0;
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+  gen = osalMemGen;
+
+  while ( hdr->val != 0 )
+  {
+    if ( hdr->hdr.inUse )
+    {
+      run = 0;
+    }
+    else
+    {
+      if ( run == 0 )
+      {
+        frag->freeRuns++;
+      }
+      run += hdr->hdr.len;
+      frag->freeMem += hdr->hdr.len;
+
+      if ( frag->maxRun < run )
+      {
+        frag->maxRun = run;
+      }
+    }
+
+    hdr = (osalMemHdr_t *)((uint8_t *)hdr + hdr->hdr.len);
+
+    if ( osalMemStep( &steps, &gen, &retry, &intState ) )
+    {
+      hdr = theHeap;
+      run = 0;
+      frag->freeMem = 0;
+      frag->freeRuns = 0;
+      frag->maxRun = 0;
+    }
+  }
+
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+
+  if ( frag->freeMem != 0 )
+  {
+    frag->fragPct = 100 - (uint8_t)(((uint32_t)frag->maxRun * 100) / frag->freeMem);
+  }
+  else
+  {
+    frag->fragPct = 0;
+  }
+}
+
+/*********************************************************************
+ * @fn      osal_mem_size
+ *
+ * @brief   Return the number of usable bytes of an allocated block,
+ *          which may exceed the number requested from osal_mem_alloc().
+ *
+ * @param   ptr - pointer returned by osal_mem_alloc()
+ *
+ * @return  usable bytes of the block
+ */
+uint16_t osal_mem_size( void *ptr )
+{
+  osalMemHdr_t *hdr = (osalMemHdr_t *)ptr - 1;
+
+  HAL_ASSERT( hdr->hdr.inUse );
+
+  return ( hdr->hdr.len - OSALMEM_HDRSZ );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_offset
+ *
+ * @brief   Convert a pointer into an allocated block to its offset from
+ *          the start of the heap. Block data never starts at offset 0,
+ *          so 0 encodes NULL.
+ *
+ * @param   ptr - pointer into the heap, or NULL
+ *
+ * @return  offset of 'ptr' in the heap, 0 for NULL
+ */
+uint16_t osal_mem_offset( void *ptr )
+{
+  if ( ptr == NULL )
+  {
+    return ( 0 );
+  }
+
+  HAL_ASSERT( ((uint8_t *)ptr > (uint8_t *)theHeap) && ((uint8_t *)ptr < (uint8_t *)theHeap+MAXMEMHEAP) );
+
+  return ( (uint16_t)((uint8_t *)ptr - (uint8_t *)theHeap) );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_ptr
+ *
+ * @brief   Convert an offset from osal_mem_offset() back to a pointer.
+ *
+ * @param   offset - offset in the heap, or 0
+ *
+ * @return  pointer into the heap, NULL for 0
+ */
+void *osal_mem_ptr( uint16_t offset )
+{
+  return ( (offset == 0) ? NULL : ((uint8_t *)theHeap + offset) );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_snapshot
+ *
+ * @brief   Write a compact binary snapshot of the heap layout. The walk
+ *          lets interrupts in every OSALMEM_CS_STEPS headers and starts
+ *          over if blocks are split or merged meanwhile, so the layout is
+ *          consistent, but a block freed during the walk may still be
+ *          reported in use. All fields are little endian:
+ *
+ *            [0]    OSALMEM_SNAP_VERSION
+ *            [1]    OSALMEM_HDRSZ
+ *            [2..3] MAXMEMHEAP
+ *            [4..5] number of blocks N
+ *            [6..]  N block headers of 2 bytes each - bits 0..14 are the
+ *                   block size including the header, bit 15 is in-use.
+ *
+ *          Block offsets follow from the running sum of the sizes.
+ *
+ * @param   buf - destination buffer
+ * @param   len - size of the destination buffer
+ *
+ * @return  number of bytes written, 0 if 'buf' is too small
+ */
+uint16_t osal_mem_snapshot( uint8_t *buf, uint16_t len )
+{
+  halIntState_t intState;
+  osalMemHdr_t *hdr = theHeap;
+  uint16_t cnt = 0;
+  uint16_t idx = OSALMEM_SNAP_HDRSZ;
+  uint16_t steps = 0;
+  uint16_t gen;
+  uint8_t retry = 0;
+
+  if ( len < OSALMEM_SNAP_HDRSZ )
+  {
+    return ( 0 );
+  }
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+  gen = osalMemGen;
+
+  while ( hdr->val != 0 )
+  {
+    if ( (idx + 2) > len )
+    {
+      break;
+    }
+
+    buf[idx++] = LO_UINT16( hdr->val );
+    buf[idx++] = HI_UINT16( hdr->val );
+    cnt++;
+
+    hdr = (osalMemHdr_t *)((uint8_t *)hdr + hdr->hdr.len);
+
+    if ( osalMemStep( &steps, &gen, &retry, &intState ) )
+    {
+      hdr = theHeap;
+      cnt = 0;
+      idx = OSALMEM_SNAP_HDRSZ;
+    }
+  }
+
+  // The walk stops early only when the buffer is too small
+  if ( hdr->val != 0 )
+  {
+    idx = 0;
+  }
+
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+
+  if ( idx != 0 )
+  {
+    buf[0] = OSALMEM_SNAP_VERSION;
+    buf[1] = OSALMEM_HDRSZ;
+    buf[2] = LO_UINT16( MAXMEMHEAP );
+    buf[3] = HI_UINT16( MAXMEMHEAP );
+    buf[4] = LO_UINT16( cnt );
+    buf[5] = HI_UINT16( cnt );
+  }
+
+  return ( idx );
+}
+
+#if OSALMEM_CS_STATS
+/*********************************************************************
+ * @fn      osal_mem_cs_stats
+ *
+ * @brief   Copy the interrupt-off statistics of the heap allocator.
+ *          'csMax' is the measured worst case of all heap critical
+ *          sections, 'stepMax' the bound on the work done in one of them.
+ *
+ * @param   stats - buffer for the statistics
+ *
+ * @return  none
+ */
+void osal_mem_cs_stats( osalMemCsStats_t *stats )
+{
+  halIntState_t intState;
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+  *stats = memCs;
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+}
+
+/*********************************************************************
+ * @fn      osal_mem_cs_reset
+ *
+ * @brief   Clear the interrupt-off statistics, e.g. to exclude the
+ *          long-lived allocations made during initialization.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osal_mem_cs_reset( void )
+{
+  halIntState_t intState;
+
+  OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+  (void)osal_memset( &memCs, 0, sizeof( memCs ) );
+  OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+}
+#endif
+
+#if OSALMEM_TRACE
+/*********************************************************************
+ * @fn      osal_mem_trace_read
+ *
+ * @brief   Copy and consume the oldest records of the allocation trace
+ *          ring.
+ *
+ * @param   buf - destination for the records
+ * @param   cnt - maximum number of records to copy
+ *
+ * @return  number of records copied
+ */
+uint16_t osal_mem_trace_read( osalMemTraceRec_t *buf, uint16_t cnt )
+{
+  halIntState_t intState;
+  uint16_t num = 0;
+
+  while ( num < cnt )
+  {
+    OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+    if ( memTraceTail == memTraceHead )
+    {
+      OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+      break;
+    }
+
+    buf[num++] = memTrace[memTraceTail++ & (OSALMEM_TRACE_CNT - 1)];
+
+    OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+  }
+
+  return ( num );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_trace_drain
+ *
+ * @brief   Feed the allocation trace ring to a sink, such as an RTT
+ *          channel or a file, one record at a time. A record is only
+ *          consumed once the sink has accepted all of it.
+ *
+ * @param   out - trace sink
+ *
+ * @return  number of records drained
+ */
+uint16_t osal_mem_trace_drain( osalMemTraceOut_t out )
+{
+  halIntState_t intState;
+  osalMemTraceRec_t rec;
+  uint16_t tail;
+  uint16_t num = 0;
+  uint8_t avail;
+
+  do
+  {
+    OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+    tail = memTraceTail;
+    avail = (tail != memTraceHead);
+    if ( avail )
+    {
+      rec = memTrace[tail & (OSALMEM_TRACE_CNT - 1)];
+    }
+
+    OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+
+    if ( !avail || (out( &rec, sizeof( rec ) ) != sizeof( rec )) )
+    {
+      break;
+    }
+
+    OSALMEM_ENTER_CS( intState );  // Hold off interrupts.
+
+    // The record may have been overwritten and skipped while it was written out
+    if ( memTraceTail == tail )
+    {
+      memTraceTail++;
+    }
+
+    OSALMEM_EXIT_CS( intState );   // Re-enable interrupts.
+
+    num++;
+  } while ( 1 );
+
+  return ( num );
+}
+
+/*********************************************************************
+ * @fn      osal_mem_trace_lost
+ *
+ * @brief   Return the number of trace records that were overwritten
+ *          before they were read.
+ *
+ * @param   none
+ *
+ * @return  number of lost records
+ */
+uint16_t osal_mem_trace_lost( void )
+{
+  return memTraceLost;
+}
+#endif
+
 /**************************************************************************************************
 */
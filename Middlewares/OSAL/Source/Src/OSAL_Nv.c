@@ -10,6 +10,8 @@
   Notes:
     - A trick buried deep in initPage() requires that the MSB of the NV Item Id
       is to be reserved for use by this module (maximum NV item Id is 0x7FFF).
+    - The MSB is also set in the stored Id of the items written by a transaction,
+      and Id 0x7FFF is reserved for the record that commits them.
 *******************************************************************************/
 
 /*********************************************************************
@@ -17,6 +19,7 @@
  */
 #include "OSAL.h"
 
+#include "OSAL_Memory.h"
 #include "OSAL_Nv.h"
 #include "OSAL_Flashutil.h"
 
@@ -49,6 +52,10 @@
 #define OSAL_NV_ZEROED_ID       0x0000
 // Reserve MSB of Id to signal a search for the "old" source copy (new write interrupted/failed.)
 #define OSAL_NV_SOURCE_ID       0x8000
+// The MSB of a stored Id marks an item written by a transaction. The run of such
+// items appended by a commit is followed by a zero-length record with this Id.
+#define OSAL_NV_TXN_ITEM        0x8000
+#define OSAL_NV_TXN_ID          0x7FFF
 
 #define OSAL_NV_PAGE_SIZE      (OSAL_NV_PHY_PER_PG * HAL_FLASH_PAGE_SIZE)
 // In case pages 0-1 are ever used, define a null page value.
@@ -61,12 +68,33 @@
 
 #define OSAL_NV_PAGE_HDR_OFFSET 0
 
-#define OSAL_NV_MAX_HOT         3
-static const uint16_t hotIds[OSAL_NV_MAX_HOT] = {
-  ZCD_NV_NWKKEY,
-  ZCD_NV_NWK_ACTIVE_KEY_INFO,
-  ZCD_NV_NWK_ALTERN_KEY_INFO,
-};
+// Entries of the RAM index of the item locations, 0 to disable the index.
+// Once more items exist than the index holds, lookups of the items left
+// out fall back to walking the pages.
+#if !defined OSAL_NV_INDEX_MAX
+  #define OSAL_NV_INDEX_MAX     64
+#endif
+
+#if ( OSAL_NV_INDEX_MAX > 0x7FFF )
+  #error OSAL_NV_INDEX_MAX must not exceed the number of NV item Ids.
+#endif
+
+// Entries of the cache of the most used items, 0 to disable the cache
+#if !defined OSAL_NV_CACHE_MAX
+  #define OSAL_NV_CACHE_MAX     8
+#endif
+
+// Data bytes kept in a cache entry. Items up to this length are read from
+// RAM while they are cached, 0 caches the item locations only.
+#if !defined OSAL_NV_CACHE_DATA_LEN
+  #define OSAL_NV_CACHE_DATA_LEN  0
+#endif
+
+// Lookups after which the cache use counts are halved, so that items no
+// longer used give way to new ones
+#if !defined OSAL_NV_CACHE_AGE
+  #define OSAL_NV_CACHE_AGE     256
+#endif
 
 /*********************************************************************
  * MACROS
@@ -75,6 +103,9 @@ static const uint16_t hotIds[OSAL_NV_MAX_HOT] = {
 #define OSAL_NV_DATA_SIZE( LEN )  \
      ((((LEN) + OSAL_NV_WORD_SIZE - 1) / OSAL_NV_WORD_SIZE) * OSAL_NV_WORD_SIZE)
 
+// Item Id of a stored header, without the transaction mark
+#define OSAL_NV_PLAIN_ID( ID )    ((ID) & 0x7FFF)
+
 #define OSAL_NV_ITEM_SIZE( LEN )  \
        (OSAL_NV_DATA_SIZE( LEN ) + OSAL_NV_HDR_SIZE)
 //  (((((LEN) + OSAL_NV_WORD_SIZE - 1) / OSAL_NV_WORD_SIZE) * OSAL_NV_WORD_SIZE) + OSAL_NV_HDR_SIZE)
@@ -140,6 +171,41 @@ typedef enum
   eNvZero
 } eNvHdrEnum;
 
+// RAM index entry of an item
+typedef struct
+{
+  uint16_t id;    // NV item id
+  uint16_t off;   // Offset of the item data into the page
+  uint16_t len;   // Length of the item data bytes
+  uint8_t  pg;    // NV page holding the item
+} osalNvIndex_t;
+
+// Cache entry of a frequently used item
+typedef struct
+{
+  uint16_t id;    // NV item id, OSAL_NV_ITEM_NULL if the entry is free
+  uint16_t off;   // Offset of the item data into the page
+  uint16_t len;   // Length of the item data bytes
+  uint16_t use;   // Lookups of the item, halved on aging
+  uint8_t  pg;    // NV page holding the item
+#if ( OSAL_NV_CACHE_DATA_LEN > 0 )
+  uint8_t  data[OSAL_NV_CACHE_DATA_LEN];  // Item data, if len fits
+#endif
+} osalNvCache_t;
+
+// Item staged by a transaction, followed by its data
+typedef struct osalNvTxnItem
+{
+  struct osalNvTxnItem *next;
+  uint16_t id;      // NV item id
+  uint16_t len;     // Length of the item data bytes
+  uint16_t srcOff;  // Offset of the data of the current copy, NULL if unchanged
+  uint16_t dstOff;  // Offset of the data of the new copy
+  uint8_t  srcPg;   // NV page of the current copy
+} osalNvTxnItem_t;
+
+#define OSAL_NV_TXN_DATA( ITEM )  ((uint8_t *)((ITEM) + 1))
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -157,13 +223,29 @@ static uint16_t pgLost[OSAL_NV_PAGES_USED];
 // Page reserved for item compacting transfer.
 static uint8_t pgRes;
 
-// NV page and offsets for hot items.
-static uint8_t hotPg[OSAL_NV_MAX_HOT];
-static uint16_t hotOff[OSAL_NV_MAX_HOT];
-
 // Temp header data, 2nd item does not change
 static uint16_t hdrData[2] = {OSAL_NV_ERASED_ID,OSAL_NV_ERASED_ID};
 
+#if ( OSAL_NV_INDEX_MAX > 0 )
+// Locations of the live items, sorted by item id
+static osalNvIndex_t nvIndex[OSAL_NV_INDEX_MAX];
+static uint16_t nvIndexCnt;
+
+// Some live items are missing from the index, a miss must walk the pages
+static uint8_t nvIndexPartial;
+#endif
+
+#if ( OSAL_NV_CACHE_MAX > 0 )
+// Most used items, least frequently used one replaced on a miss
+static osalNvCache_t nvCache[OSAL_NV_CACHE_MAX];
+static uint16_t nvCacheAge;
+static osalNvCacheStats_t nvCacheStats;
+#endif
+
+// Items staged by the open transaction, in the order they were first written
+static osalNvTxnItem_t *nvTxnHead;
+static uint8_t nvTxnOpen;
+
 /******************************************************************************
  * LOCAL FUNCTIONS
  */
@@ -189,8 +271,29 @@ static void   writeBuf( uint8_t pg, uint16_t offset, uint16_t len, uint8_t *buf
 static void   xferBuf( uint8_t srcPg, uint16_t srcOff, uint8_t dstPg, uint16_t dstOff, uint16_t len );
 
 static uint8_t  writeItem( uint8_t pg, uint16_t id, uint16_t len, void *buf, uint8_t flag );
-static uint8_t  hotItem(uint16_t id);
-static void   hotItemUpdate(uint8_t pg, uint16_t off, uint16_t id);
+static void   itemUpdate( uint8_t pg, uint16_t off, uint16_t id );
+
+#if ( OSAL_NV_INDEX_MAX > 0 )
+static uint16_t nvIndexPos( uint16_t id );
+static osalNvIndex_t *nvIndexFind( uint16_t id );
+static void   nvIndexSet( uint16_t id, uint8_t pg, uint16_t off );
+static void   nvIndexRemove( uint16_t id );
+static void   nvIndexDropPage( uint8_t pg );
+static void   nvIndexBuild( void );
+#endif
+
+#if ( OSAL_NV_CACHE_MAX > 0 )
+static osalNvCache_t *nvCacheLookup( uint16_t id );
+static void   nvCacheFill( osalNvCache_t *ent, uint8_t pg, uint16_t off );
+static void   nvCacheUpdate( uint8_t pg, uint16_t off, uint16_t id );
+static void   nvCacheRemove( uint16_t id );
+static void   nvCacheDropPage( uint8_t pg );
+#endif
+
+static uint8_t  txnPage( uint16_t sz );
+static void   txnRecover( void );
+static void   txnRecoverRun( uint8_t pg, uint16_t runOff, uint16_t endOff );
+static void   txnDropCopies( uint8_t keepPg, uint16_t keepOff, uint16_t id );
 
 /******************************************************************************
  * @fn      initNV
@@ -268,6 +371,9 @@ static uint8_t initNV( void )
    * size less the page header.
    */
 
+  // Settle any transaction interrupted by a power-cycle before duplicates are resolved.
+  txnRecover();
+
   for ( pg = 0; pg < OSAL_NV_PAGES_USED; pg++ )
   {
     // Calculate page offset and lost bytes - any "old" item triggers an N^2 re-scan from start.
@@ -313,6 +419,15 @@ static uint8_t initNV( void )
     erasePage( pgRes );  // The last page erase had been interrupted by a power-cycle.
   }
 
+#if ( OSAL_NV_INDEX_MAX > 0 )
+  nvIndexBuild();
+#endif
+
+#if ( OSAL_NV_CACHE_MAX > 0 )
+  // Locations found before a recovery are not trusted
+  osal_memset( nvCache, 0, sizeof( nvCache ) );
+#endif
+
   return TRUE;
 }
 
@@ -389,7 +504,7 @@ static uint16_t initPage( uint8_t pg, uint16_t id, uint8_t findDups )
          * of a successful new item write that gets interrupted before the
          * old item can be zeroed out.
          */
-        if ( (id & 0x7fff) == hdr.id )
+        if ( (id & 0x7fff) == OSAL_NV_PLAIN_ID( hdr.id ) )
         {
           if ( (((id & OSAL_NV_SOURCE_ID) == 0) && (hdr.stat == OSAL_NV_ERASED_ID)) ||
                (((id & OSAL_NV_SOURCE_ID) != 0) && (hdr.stat != OSAL_NV_ERASED_ID)) )
@@ -468,6 +583,13 @@ static void erasePage( uint8_t pg )
 
   pgOff[pg] = OSAL_NV_PG_HDR_SIZE;
   pgLost[pg] = 0;
+
+#if ( OSAL_NV_INDEX_MAX > 0 )
+  nvIndexDropPage( pg );
+#endif
+#if ( OSAL_NV_CACHE_MAX > 0 )
+  nvCacheDropPage( pg );
+#endif
 }
 
 /******************************************************************************
@@ -526,7 +648,11 @@ static uint8_t compactPage( uint8_t srcPg, uint16_t skipId )
 
     srcOff += OSAL_NV_HDR_SIZE;
 
-    if ( (hdr.live != OSAL_NV_ZEROED_ID) && (hdr.id != skipId) )
+    /* Transactions are settled by now, so their commit records are dropped and their items
+     * are moved as plain items.
+     */
+    if ( (hdr.live != OSAL_NV_ZEROED_ID) && (hdr.id != OSAL_NV_TXN_ID) &&
+         (OSAL_NV_PLAIN_ID( hdr.id ) != skipId) )
     {
       if ( hdr.chk == calcChkF( srcPg, srcOff, hdr.len ) )
       {
@@ -538,7 +664,7 @@ static uint8_t compactPage( uint8_t srcPg, uint16_t skipId )
           setItem( srcPg, srcOff, eNvXfer );
         }
 
-        if ( writeItem( pgRes, hdr.id, hdr.len, NULL, FALSE ) )
+        if ( writeItem( pgRes, OSAL_NV_PLAIN_ID( hdr.id ), hdr.len, NULL, FALSE ) )
         {
           uint16_t chk;
 
@@ -559,7 +685,7 @@ static uint8_t compactPage( uint8_t srcPg, uint16_t skipId )
           }
           else
           {
-            hotItemUpdate(pgRes, dstOff + OSAL_NV_HDR_SIZE, hdr.id);
+            itemUpdate(pgRes, dstOff + OSAL_NV_HDR_SIZE, hdr.id);
           }
         }
         else
@@ -590,6 +716,8 @@ static uint8_t compactPage( uint8_t srcPg, uint16_t skipId )
  * @fn      findItem
  *
  * @brief   Find an item Id in NV and return the page and offset to its data.
+ *          The RAM index answers first, the pages are only walked for an
+ *          item that the index could not hold.
  *
  * @param   id - Valid NV item Id.
  *
@@ -602,28 +730,60 @@ static uint8_t compactPage( uint8_t srcPg, uint16_t skipId )
  */
 static uint16_t findItem( uint16_t id, uint8_t *findPg )
 {
-  uint16_t off;
+  uint16_t off = OSAL_NV_ITEM_NULL;
   uint8_t pg;
 
+#if ( OSAL_NV_INDEX_MAX > 0 )
+  if ( (id & OSAL_NV_SOURCE_ID) == 0 )
+  {
+    osalNvIndex_t *ent = nvIndexFind( id );
+
+    if ( ent != NULL )
+    {
+      *findPg = ent->pg;
+      return ent->off;
+    }
+
+    // A complete index knows every live item.
+    if ( !nvIndexPartial )
+    {
+      *findPg = OSAL_NV_PAGE_NULL;
+      return OSAL_NV_ITEM_NULL;
+    }
+  }
+#endif
+
   for ( pg = 0; pg < OSAL_NV_PAGES_USED; pg++ )
   {
     if ( (off = initPage( pg, id, FALSE )) != OSAL_NV_ITEM_NULL )
     {
       *findPg = pg;
-      return off;
+      break;
     }
   }
 
-  // Now attempt to find the item as the "old" item of a failed/interrupted NV write.
   if ( (id & OSAL_NV_SOURCE_ID) == 0 )
+  {
+    // Now attempt to find the item as the "old" item of a failed/interrupted NV write.
+    if ( off == OSAL_NV_ITEM_NULL )
+    {
+      off = findItem( (id | OSAL_NV_SOURCE_ID), findPg );
+    }
+
+#if ( OSAL_NV_INDEX_MAX > 0 )
+    // Index the item found by walking the pages, if there is room.
+    if ( off != OSAL_NV_ITEM_NULL )
     {
-    return findItem( (id | OSAL_NV_SOURCE_ID), findPg );
+      nvIndexSet( id, *findPg, off );
+    }
+#endif
   }
-  else
+  else if ( off == OSAL_NV_ITEM_NULL )
   {
-  *findPg = OSAL_NV_PAGE_NULL;
-  return OSAL_NV_ITEM_NULL;
-}
+    *findPg = OSAL_NV_PAGE_NULL;
+  }
+
+  return off;
 }
 
 /******************************************************************************
@@ -1037,7 +1197,7 @@ static uint8_t writeItem( uint8_t pg, uint16_t id, uint16_t len, void *buf, uint
 
         if ( chk == hdr.chk )
         {
-          hotItemUpdate(pg, datOff, hdr.id);
+          itemUpdate(pg, datOff, hdr.id);
           rtrn = TRUE;
         }
       }
@@ -1066,239 +1226,828 @@ static uint8_t writeItem( uint8_t pg, uint16_t id, uint16_t len, void *buf, uint
 }
 
 /******************************************************************************
- * @fn      hotItem
+ * @fn      itemUpdate
  *
- * @brief   Look for the parameter 'id' in the hot items array.
+ * @brief   Record the new location of an item written or moved to NV.
+ *          Items written by a transaction are left to osal_nv_txn_commit().
  *
+ * @param   pg - The new NV page of the item.
+ * @param   off - The new NV page offset of the item data.
  * @param   id - A valid NV item Id.
  *
- * @return  A valid index into the hot items if the item is hot; OSAL_NV_MAX_HOT if not.
+ * @return  none
  */
-static uint8_t hotItem(uint16_t id)
+static void itemUpdate( uint8_t pg, uint16_t off, uint16_t id )
 {
-  uint8_t hotIdx;
-
-  for (hotIdx = 0; hotIdx < OSAL_NV_MAX_HOT; hotIdx++)
+  // The items of a transaction are recorded once it has committed
+  if ( id & OSAL_NV_TXN_ITEM )
   {
-    if (hotIds[hotIdx] == id)
-    {
-      break;
-    }
+    return;
   }
 
-  return hotIdx;
+#if ( OSAL_NV_INDEX_MAX > 0 )
+  nvIndexSet( id, pg, off );
+#endif
+#if ( OSAL_NV_CACHE_MAX > 0 )
+  nvCacheUpdate( pg, off, id );
+#endif
 }
 
+#if ( OSAL_NV_INDEX_MAX > 0 )
 /******************************************************************************
- * @fn      hotItemUpdate
+ * @fn      nvIndexPos
  *
- * @brief   If the parameter 'id' is a hot item, update the corresponding hot item data.
+ * @brief   Binary search of the RAM index.
  *
- * @param   pg - The new NV page corresponding to the hot item.
- * @param   off - The new NV page offset corresponding to the hot item.
  * @param   id - A valid NV item Id.
  *
- * @return  none
+ * @return  Position of the first entry with an Id not below 'id'.
  */
-static void hotItemUpdate(uint8_t pg, uint16_t off, uint16_t id)
+static uint16_t nvIndexPos( uint16_t id )
 {
-  uint8_t hotIdx = hotItem(id);
+  uint16_t lo = 0;
+  uint16_t hi = nvIndexCnt;
 
-  if (hotIdx < OSAL_NV_MAX_HOT)
+  while ( lo < hi )
   {
+    uint16_t mid = (lo + hi) / 2;
+
+    if ( nvIndex[mid].id < id )
     {
-      hotPg[hotIdx] = pg;
-      hotOff[hotIdx] = off;
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
     }
   }
+
+  return lo;
 }
 
 /******************************************************************************
- * @fn      osal_nv_init
+ * @fn      nvIndexFind
  *
- * @brief   Initialize NV service.
+ * @brief   Look up the location of an item in the RAM index.
  *
- * @param   p - Not used.
+ * @param   id - A valid NV item Id.
  *
- * @return  none
+ * @return  The index entry of the item, NULL if it is not indexed.
  */
-void osal_nv_init( void *p )
+static osalNvIndex_t *nvIndexFind( uint16_t id )
 {
-  (void)p;  // Suppress Lint warning.
-  (void)initNV();  // Always returns TRUE after pages have been erased.
+  uint16_t pos = nvIndexPos( id );
+
+  if ( (pos < nvIndexCnt) && (nvIndex[pos].id == id) )
+  {
+    return &nvIndex[pos];
+  }
+
+  return NULL;
 }
 
 /******************************************************************************
- * @fn      osal_nv_item_init
+ * @fn      nvIndexSet
  *
- * @brief   If the NV item does not already exist, it is created and
- *          initialized with the data passed to the function, if any.
- *          This function must be called before calling osal_nv_read() or
- *          osal_nv_write().
+ * @brief   Record the new location of an item in the RAM index. When the
+ *          index is full the item is left out and the index is marked
+ *          partial.
  *
- * @param   id  - Valid NV item Id.
- * @param   len - Item length.
- * @param  *buf - Pointer to item initalization data. Set to NULL if none.
+ * @param   id - A valid NV item Id.
+ * @param   pg - The NV page holding the item.
+ * @param   off - The offset of the item data into the page.
  *
- * @return  NV_ITEM_UNINIT - Id did not exist and was created successfully.
- *          OSAL_SUCCESS       - Id already existed, no action taken.
- *          NV_OPER_FAILED - Failure to find or create Id.
+ * @return  none
  */
-uint8_t osal_nv_item_init( uint16_t id, uint16_t len, void *buf )
+static void nvIndexSet( uint16_t id, uint8_t pg, uint16_t off )
 {
-  uint8_t findPg;
-  uint16_t offset;
+  osalNvHdr_t hdr;
+  uint16_t pos = nvIndexPos( id );
+  uint16_t idx;
 
-  if ( hotItem( id ) < OSAL_NV_MAX_HOT )
+  if ( (pos == nvIndexCnt) || (nvIndex[pos].id != id) )
   {
-    return NV_OPER_FAILED;
-  }
-  else if ((offset = findItem(id, &findPg)) != OSAL_NV_ITEM_NULL)
+    if ( nvIndexCnt == OSAL_NV_INDEX_MAX )
     {
-    // Re-populate the NV hot item data if the corresponding items are already established.
-    hotItemUpdate(findPg, offset, id);
-
-    return OSAL_SUCCESS;
+      nvIndexPartial = TRUE;
+      return;
     }
-  else if ( initItem( TRUE, id, len, buf ) != OSAL_NV_PAGE_NULL )
+
+    // Open a gap for the new entry
+    for ( idx = nvIndexCnt; idx > pos; idx-- )
     {
-      return NV_ITEM_UNINIT;
+      nvIndex[idx] = nvIndex[idx - 1];
     }
-  else
-  {
-    return NV_OPER_FAILED;
+    nvIndexCnt++;
   }
+
+  readHdr( pg, (off - OSAL_NV_HDR_SIZE), (uint8_t *)(&hdr) );
+
+  nvIndex[pos].id = id;
+  nvIndex[pos].off = off;
+  nvIndex[pos].len = hdr.len;
+  nvIndex[pos].pg = pg;
 }
 
 /******************************************************************************
- * @fn      osal_nv_item_len
+ * @fn      nvIndexRemove
  *
- * @brief   Get the data length of the item stored in NV memory.
+ * @brief   Remove a deleted item from the RAM index.
  *
- * @param   id  - Valid NV item Id.
+ * @param   id - A valid NV item Id.
  *
- * @return  Item length, if found; zero otherwise.
+ * @return  none
  */
-uint16_t osal_nv_item_len( uint16_t id )
+static void nvIndexRemove( uint16_t id )
 {
-  uint8_t findPg;
-  osalNvHdr_t hdr;
-  uint16_t offset;
-  uint8_t hotIdx;
+  uint16_t pos = nvIndexPos( id );
 
-  if ((hotIdx = hotItem(id)) < OSAL_NV_MAX_HOT)
+  if ( (pos < nvIndexCnt) && (nvIndex[pos].id == id) )
   {
-    findPg = hotPg[hotIdx];
-    offset = hotOff[hotIdx];
+    nvIndexCnt--;
+    for ( ; pos < nvIndexCnt; pos++ )
+    {
+      nvIndex[pos] = nvIndex[pos + 1];
+    }
   }
-  else if ((offset = findItem(id, &findPg)) == OSAL_NV_ITEM_NULL)
+}
+
+/******************************************************************************
+ * @fn      nvIndexDropPage
+ *
+ * @brief   Remove the entries of an erased page from the RAM index. Items
+ *          can only be left behind on a page whose compaction was aborted,
+ *          their older copies are then found by walking the pages.
+ *
+ * @param   pg - The erased NV page.
+ *
+ * @return  none
+ */
+static void nvIndexDropPage( uint8_t pg )
+{
+  uint16_t src, dst = 0;
+
+  for ( src = 0; src < nvIndexCnt; src++ )
   {
-    return 0;
+    if ( nvIndex[src].pg != pg )
+    {
+      nvIndex[dst++] = nvIndex[src];
+    }
   }
 
-    readHdr( findPg, (offset - OSAL_NV_HDR_SIZE), (uint8_t *)(&hdr) );
-    return hdr.len;
+  if ( dst != nvIndexCnt )
+  {
+    nvIndexCnt = dst;
+    nvIndexPartial = TRUE;
   }
+}
 
 /******************************************************************************
- * @fn      osal_nv_write
+ * @fn      nvIndexBuild
  *
- * @brief   Write a data item to NV. Function can write an entire item to NV or
- *          an element of an item by indexing into the item with an offset.
+ * @brief   Build the RAM index from the pages checked by initNV(). Of two
+ *          live copies of an item, the one not marked for transfer wins,
+ *          as with findItem().
  *
- * @param   id  - Valid NV item Id.
- * @param   ndx - Index offset into item
- * @param   len - Length of data to write.
- * @param  *buf - Data to write.
+ * @param   none
  *
- * @return  OSAL_SUCCESS if successful, NV_ITEM_UNINIT if item did not
- *          exist in NV and offset is non-zero, NV_OPER_FAILED if failure.
+ * @return  none
  */
-uint8_t osal_nv_write( uint16_t id, uint16_t ndx, uint16_t len, void *buf )
+static void nvIndexBuild( void )
 {
-  uint8_t rtrn = OSAL_SUCCESS;
+  osalNvHdr_t hdr;
+  uint16_t offset, sz;
+  uint8_t pg;
 
-  if ( len != 0 )
+  nvIndexCnt = 0;
+  nvIndexPartial = FALSE;
+
+  for ( pg = 0; pg < OSAL_NV_PAGES_USED; pg++ )
   {
-    osalNvHdr_t hdr;
-    uint16_t origOff, srcOff;
-    uint16_t cnt, chk;
-    uint8_t *addr, *ptr, srcPg;
+    offset = OSAL_NV_PG_HDR_SIZE;
 
-    origOff = srcOff = findItem( id, &srcPg );
-    if ( srcOff == OSAL_NV_ITEM_NULL )
+    while ( offset < (OSAL_NV_PAGE_SIZE - OSAL_NV_HDR_SIZE) )
     {
-      return NV_ITEM_UNINIT;
+      readHdr( pg, offset, (uint8_t *)(&hdr) );
+
+      if ( hdr.id == OSAL_NV_ERASED_ID )
+      {
+        break;
+      }
+
+      sz = OSAL_NV_DATA_SIZE( hdr.len );
+      if ( sz > (OSAL_NV_PAGE_SIZE - OSAL_NV_HDR_SIZE - offset) )
+      {
+        break;
+      }
+
+      offset += OSAL_NV_HDR_SIZE;
+
+      if ( (hdr.live != OSAL_NV_ZEROED_ID) && (hdr.id != OSAL_NV_TXN_ID) &&
+           ((hdr.stat == OSAL_NV_ERASED_ID) || (nvIndexFind( OSAL_NV_PLAIN_ID( hdr.id ) ) == NULL)) )
+      {
+        nvIndexSet( OSAL_NV_PLAIN_ID( hdr.id ), pg, offset );
+      }
+
+      offset += sz;
     }
+  }
+}
+#endif
 
-    readHdr( srcPg, (srcOff - OSAL_NV_HDR_SIZE), (uint8_t *)(&hdr) );
-    if ( hdr.len < (ndx + len) )
+#if ( OSAL_NV_CACHE_MAX > 0 )
+/******************************************************************************
+ * @fn      nvCacheLookup
+ *
+ * @brief   Look up an item in the cache. On a miss the item is found in NV
+ *          and replaces the least used entry.
+ *
+ * @param   id - Valid NV item Id.
+ *
+ * @return  Cache entry of the item, NULL if the item does not exist.
+ */
+static osalNvCache_t *nvCacheLookup( uint16_t id )
+{
+  osalNvCache_t *ent, *victim;
+  uint16_t offset;
+  uint8_t findPg;
+
+  // Age the use counts so that a burst of lookups does not pin an item forever
+  if ( ++nvCacheAge >= OSAL_NV_CACHE_AGE )
+  {
+    nvCacheAge = 0;
+    for ( ent = nvCache; ent < (nvCache + OSAL_NV_CACHE_MAX); ent++ )
     {
-      return NV_OPER_FAILED;
+      ent->use >>= 1;
     }
+  }
 
-    addr = OSAL_NV_PAGE_TO_PTR( srcPg ) + srcOff + ndx;
-    ptr = buf;
-    cnt = len;
-    chk = 0;
-    while ( cnt-- )
+  victim = nvCache;
+  for ( ent = nvCache; ent < (nvCache + OSAL_NV_CACHE_MAX); ent++ )
+  {
+    if ( ent->id == id )
     {
-      if ( *addr != *ptr )
+      if ( ent->use != 0xFFFF )
       {
-        chk += 1;  // Count number of different bytes
-        // Calculate expected checksum after transferring old data and writing new data.
-        hdr.chk -= *addr;
-        hdr.chk += *ptr;
+        ent->use++;
       }
-      addr++;
-      ptr++;
+      nvCacheStats.hits++;
+      return ent;
     }
 
-    if ( chk != 0 )  // If the buffer to write is different in one or more bytes.
+    // A free entry is taken first, else the least used one
+    if ( (victim->id != OSAL_NV_ITEM_NULL) &&
+         ((ent->id == OSAL_NV_ITEM_NULL) || (ent->use < victim->use)) )
     {
-      uint8_t comPg = OSAL_NV_PAGE_NULL;
-      uint8_t dstPg = initItem( FALSE, id, hdr.len, &comPg );
-
-      if ( dstPg != OSAL_NV_PAGE_NULL )
-      {
-        uint16_t tmp = OSAL_NV_DATA_SIZE( hdr.len );
-        uint16_t dstOff = pgOff[dstPg] - tmp;
-        srcOff = origOff;
-        chk = hdr.chk;
+      victim = ent;
+    }
+  }
 
-        /* Prevent excessive re-writes to item header caused by numerous, rapid,
-         * and successive OSAL_Nv interruptions caused by resets.
-         */
-        if ( hdr.stat == OSAL_NV_ERASED_ID )
-        {
-          setItem( srcPg, srcOff, eNvXfer );
-        }
+  nvCacheStats.misses++;
 
-        xferBuf( srcPg, srcOff, dstPg, dstOff, ndx );
-        srcOff += ndx;
-        dstOff += ndx;
+  if ( (offset = findItem( id, &findPg )) == OSAL_NV_ITEM_NULL )
+  {
+    return NULL;
+  }
 
-        writeBuf( dstPg, dstOff, len, buf );
-        srcOff += len;
-        dstOff += len;
+  if ( victim->id != OSAL_NV_ITEM_NULL )
+  {
+    nvCacheStats.evictions++;
+  }
 
-        xferBuf( srcPg, srcOff, dstPg, dstOff, (hdr.len-ndx-len) );
+  victim->id = id;
+  victim->use = 1;
+  nvCacheFill( victim, findPg, offset );
 
-        // Calculate and write the new checksum.
-        dstOff = pgOff[dstPg] - tmp;
-        hdrData[0] = calcChkF( dstPg, dstOff, hdr.len );
-        dstOff -= OSAL_NV_HDR_SIZE;
-        flashWrite(OSAL_NV_PAGE_TO_PTR(dstPg) + dstOff + OSAL_NV_HDR_CHK,
-                   OSAL_NV_HDR_ITEM, (uint8_t *)(hdrData));
-        readHdr( dstPg, dstOff, (uint8_t *)(&hdr) );
+  return victim;
+}
 
-        if ( chk != hdr.chk )
-        {
-          rtrn = NV_OPER_FAILED;
+/******************************************************************************
+ * @fn      nvCacheFill
+ *
+ * @brief   Load the location and length of an item into a cache entry, and
+ *          its data if it fits.
+ *
+ * @param   ent - Cache entry of the item.
+ * @param   pg - NV page of the item.
+ * @param   off - NV page offset of the item data.
+ *
+ * @return  none
+ */
+static void nvCacheFill( osalNvCache_t *ent, uint8_t pg, uint16_t off )
+{
+  osalNvHdr_t hdr;
+
+  readHdr( pg, (off - OSAL_NV_HDR_SIZE), (uint8_t *)(&hdr) );
+
+  ent->pg = pg;
+  ent->off = off;
+  ent->len = hdr.len;
+
+#if ( OSAL_NV_CACHE_DATA_LEN > 0 )
+  if ( hdr.len <= OSAL_NV_CACHE_DATA_LEN )
+  {
+    osal_memcpy( ent->data, (OSAL_NV_PAGE_TO_PTR( pg ) + off), hdr.len );
+  }
+#endif
+}
+
+/******************************************************************************
+ * @fn      nvCacheUpdate
+ *
+ * @brief   Reload a cached item after it was written or moved in NV.
+ *
+ * @param   pg - The new NV page of the item.
+ * @param   off - The new NV page offset of the item data.
+ * @param   id - A valid NV item Id.
+ *
+ * @return  none
+ */
+static void nvCacheUpdate( uint8_t pg, uint16_t off, uint16_t id )
+{
+  osalNvCache_t *ent;
+
+  for ( ent = nvCache; ent < (nvCache + OSAL_NV_CACHE_MAX); ent++ )
+  {
+    if ( ent->id == id )
+    {
+      nvCacheFill( ent, pg, off );
+      break;
+    }
+  }
+}
+
+/******************************************************************************
+ * @fn      nvCacheRemove
+ *
+ * @brief   Drop a deleted item from the cache.
+ *
+ * @param   id - A valid NV item Id.
+ *
+ * @return  none
+ */
+static void nvCacheRemove( uint16_t id )
+{
+  osalNvCache_t *ent;
+
+  for ( ent = nvCache; ent < (nvCache + OSAL_NV_CACHE_MAX); ent++ )
+  {
+    if ( ent->id == id )
+    {
+      ent->id = OSAL_NV_ITEM_NULL;
+      break;
+    }
+  }
+}
+
+/******************************************************************************
+ * @fn      nvCacheDropPage
+ *
+ * @brief   Drop the cached items of a page being erased.
+ *
+ * @param   pg - Valid NV page.
+ *
+ * @return  none
+ */
+static void nvCacheDropPage( uint8_t pg )
+{
+  osalNvCache_t *ent;
+
+  for ( ent = nvCache; ent < (nvCache + OSAL_NV_CACHE_MAX); ent++ )
+  {
+    if ( (ent->id != OSAL_NV_ITEM_NULL) && (ent->pg == pg) )
+    {
+      ent->id = OSAL_NV_ITEM_NULL;
+    }
+  }
+}
+#endif
+
+/******************************************************************************
+ * @fn      txnPage
+ *
+ * @brief   Find a page with room to append all the items of a transaction
+ *          in one run, compacting a page if that is needed to make room.
+ *
+ * @param   sz - Bytes needed for the items and the commit record.
+ *
+ * @return  The OSAL Nv page to append to, OSAL_NV_PAGE_NULL if none.
+ */
+static uint8_t txnPage( uint16_t sz )
+{
+  uint8_t cnt = OSAL_NV_PAGES_USED;
+  uint8_t pg = pgRes+1;  // Set to 1 after the reserve page to even wear across all available pages.
+
+  if ( sz > (OSAL_NV_PAGE_SIZE - OSAL_NV_PG_HDR_SIZE) )
+  {
+    return OSAL_NV_PAGE_NULL;
+  }
+
+  do {
+    if (pg >= OSAL_NV_PAGES_USED)
+    {
+      pg = 0;
+    }
+    if ( pg != pgRes )
+    {
+      if ( sz <= (OSAL_NV_PAGE_SIZE - pgOff[pg] + pgLost[pg]) )
+      {
+        break;
+      }
+    }
+    pg++;
+  } while (--cnt);
+
+  if ( cnt == 0 )
+  {
+    return OSAL_NV_PAGE_NULL;
+  }
+
+  // The run fits once the page is compacted onto the reserve page.
+  if ( sz > (OSAL_NV_PAGE_SIZE - pgOff[pg]) )
+  {
+    uint8_t dstPg = pgRes;
+
+    markPage( pg, OSAL_NV_PG_XFER );
+
+    if ( !compactPage( pg, OSAL_NV_ITEM_NULL ) || (sz > (OSAL_NV_PAGE_SIZE - pgOff[dstPg])) )
+    {
+      return OSAL_NV_PAGE_NULL;
+    }
+
+    pg = dstPg;
+  }
+
+  return pg;
+}
+
+/******************************************************************************
+ * @fn      txnRecover
+ *
+ * @brief   Find the runs of transaction items in NV and settle each one as
+ *          committed or not, see txnRecoverRun().
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void txnRecover( void )
+{
+  osalNvHdr_t hdr;
+  uint16_t offset, runOff, sz;
+  uint8_t pg;
+
+  for ( pg = 0; pg < OSAL_NV_PAGES_USED; pg++ )
+  {
+    offset = OSAL_NV_PG_HDR_SIZE;
+    runOff = OSAL_NV_ITEM_NULL;
+
+    while ( offset < (OSAL_NV_PAGE_SIZE - OSAL_NV_HDR_SIZE) )
+    {
+      readHdr( pg, offset, (uint8_t *)(&hdr) );
+
+      if ( hdr.id == OSAL_NV_ERASED_ID )
+      {
+        break;
+      }
+
+      sz = OSAL_NV_DATA_SIZE( hdr.len );
+      if ( sz > (OSAL_NV_PAGE_SIZE - OSAL_NV_HDR_SIZE - offset) )
+      {
+        break;
+      }
+
+      if ( hdr.id & OSAL_NV_TXN_ITEM )
+      {
+        if ( runOff == OSAL_NV_ITEM_NULL )
+        {
+          runOff = offset;
+        }
+      }
+      else if ( runOff != OSAL_NV_ITEM_NULL )
+      {
+        txnRecoverRun( pg, runOff, offset );
+        runOff = OSAL_NV_ITEM_NULL;
+      }
+
+      offset += OSAL_NV_HDR_SIZE + sz;
+    }
+
+    if ( runOff != OSAL_NV_ITEM_NULL )
+    {
+      txnRecoverRun( pg, runOff, offset );
+    }
+  }
+}
+
+/******************************************************************************
+ * @fn      txnRecoverRun
+ *
+ * @brief   Settle a run of transaction items. Without a good commit record
+ *          after it, the run is zeroed and the previous copies of its
+ *          items stay in use. With a live commit record, the commit was
+ *          interrupted before the previous copies were zeroed, so that is
+ *          finished. A zeroed commit record means the run is settled.
+ *
+ * @param   pg - Valid NV page.
+ * @param   runOff - Offset of the header of the first item of the run.
+ * @param   endOff - Offset of the header following the run.
+ *
+ * @return  none
+ */
+static void txnRecoverRun( uint8_t pg, uint16_t runOff, uint16_t endOff )
+{
+  osalNvHdr_t hdr;
+  uint8_t commit = FALSE;
+  uint8_t record = FALSE;
+
+  // Being zero-length, the record may end right at the end of the page.
+  if ( endOff <= (OSAL_NV_PAGE_SIZE - OSAL_NV_HDR_SIZE) )
+  {
+    readHdr( pg, endOff, (uint8_t *)(&hdr) );
+
+    if ( (hdr.id == OSAL_NV_TXN_ID) && (hdr.len == 0) )
+    {
+      if ( hdr.live == OSAL_NV_ZEROED_ID )
+      {
+        return;
+      }
+
+      record = TRUE;
+      commit = (hdr.chk == 0);
+    }
+  }
+
+  while ( runOff < endOff )
+  {
+    readHdr( pg, runOff, (uint8_t *)(&hdr) );
+    runOff += OSAL_NV_HDR_SIZE;
+
+    if ( hdr.live != OSAL_NV_ZEROED_ID )
+    {
+      if ( commit )
+      {
+        txnDropCopies( pg, runOff, OSAL_NV_PLAIN_ID( hdr.id ) );
+      }
+      else
+      {
+        setItem( pg, runOff, eNvZero );
+      }
+    }
+
+    runOff += OSAL_NV_DATA_SIZE( hdr.len );
+  }
+
+  // Zeroed last, so that a settlement interrupted by a power-cycle is done over.
+  if ( record )
+  {
+    setItem( pg, endOff + OSAL_NV_HDR_SIZE, eNvZero );
+  }
+}
+
+/******************************************************************************
+ * @fn      txnDropCopies
+ *
+ * @brief   Zero every live copy of an item except the one committed by a
+ *          transaction.
+ *
+ * @param   keepPg - NV page of the committed copy.
+ * @param   keepOff - NV page offset of the data of the committed copy.
+ * @param   id - Valid NV item Id.
+ *
+ * @return  none
+ */
+static void txnDropCopies( uint8_t keepPg, uint16_t keepOff, uint16_t id )
+{
+  osalNvHdr_t hdr;
+  uint16_t offset, sz;
+  uint8_t pg;
+
+  for ( pg = 0; pg < OSAL_NV_PAGES_USED; pg++ )
+  {
+    offset = OSAL_NV_PG_HDR_SIZE;
+
+    while ( offset < (OSAL_NV_PAGE_SIZE - OSAL_NV_HDR_SIZE) )
+    {
+      readHdr( pg, offset, (uint8_t *)(&hdr) );
+
+      if ( hdr.id == OSAL_NV_ERASED_ID )
+      {
+        break;
+      }
+
+      sz = OSAL_NV_DATA_SIZE( hdr.len );
+      if ( sz > (OSAL_NV_PAGE_SIZE - OSAL_NV_HDR_SIZE - offset) )
+      {
+        break;
+      }
+
+      offset += OSAL_NV_HDR_SIZE;
+
+      if ( (hdr.live != OSAL_NV_ZEROED_ID) && (hdr.id != OSAL_NV_TXN_ID) &&
+           (OSAL_NV_PLAIN_ID( hdr.id ) == id) && ((pg != keepPg) || (offset != keepOff)) )
+      {
+        setItem( pg, offset, eNvZero );
+      }
+
+      offset += sz;
+    }
+  }
+}
+
+/******************************************************************************
+ * @fn      osal_nv_init
+ *
+ * @brief   Initialize NV service.
+ *
+ * @param   p - Not used.
+ *
+ * @return  none
+ */
+void osal_nv_init( void *p )
+{
+  (void)p;  // Suppress Lint warning.
+  (void)initNV();  // Always returns TRUE after pages have been erased.
+}
+
+/******************************************************************************
+ * @fn      osal_nv_item_init
+ *
+ * @brief   If the NV item does not already exist, it is created and
+ *          initialized with the data passed to the function, if any.
+ *          This function must be called before calling osal_nv_read() or
+ *          osal_nv_write().
+ *
+ * @param   id  - Valid NV item Id.
+ * @param   len - Item length.
+ * @param  *buf - Pointer to item initalization data. Set to NULL if none.
+ *
+ * @return  NV_ITEM_UNINIT - Id did not exist and was created successfully.
+ *          OSAL_SUCCESS       - Id already existed, no action taken.
+ *          NV_OPER_FAILED - Failure to find or create Id.
+ */
+uint8_t osal_nv_item_init( uint16_t id, uint16_t len, void *buf )
+{
+  uint8_t findPg;
+
+  if ( id >= OSAL_NV_TXN_ID )
+  {
+    return NV_OPER_FAILED;
+  }
+  else if ( findItem( id, &findPg ) != OSAL_NV_ITEM_NULL )
+    {
+    return OSAL_SUCCESS;
+    }
+  else if ( initItem( TRUE, id, len, buf ) != OSAL_NV_PAGE_NULL )
+    {
+      return NV_ITEM_UNINIT;
+    }
+  else
+  {
+    return NV_OPER_FAILED;
+  }
+}
+
+/******************************************************************************
+ * @fn      osal_nv_item_len
+ *
+ * @brief   Get the data length of the item stored in NV memory.
+ *
+ * @param   id  - Valid NV item Id.
+ *
+ * @return  Item length, if found; zero otherwise.
+ */
+uint16_t osal_nv_item_len( uint16_t id )
+{
+#if ( OSAL_NV_CACHE_MAX > 0 )
+  osalNvCache_t *ent = nvCacheLookup( id );
+
+  return ( (ent != NULL) ? ent->len : 0 );
+#else
+  uint8_t findPg;
+  osalNvHdr_t hdr;
+  uint16_t offset;
+
+  if ((offset = findItem(id, &findPg)) == OSAL_NV_ITEM_NULL)
+  {
+    return 0;
+  }
+#if ( OSAL_NV_INDEX_MAX > 0 )
+  else
+  {
+    osalNvIndex_t *ent = nvIndexFind( id );
+
+    if ( ent != NULL )
+    {
+      return ent->len;
+    }
+  }
+#endif
+
+    readHdr( findPg, (offset - OSAL_NV_HDR_SIZE), (uint8_t *)(&hdr) );
+    return hdr.len;
+#endif
+  }
+
+/******************************************************************************
+ * @fn      osal_nv_write
+ *
+ * @brief   Write a data item to NV. Function can write an entire item to NV or
+ *          an element of an item by indexing into the item with an offset.
+ *
+ * @param   id  - Valid NV item Id.
+ * @param   ndx - Index offset into item
+ * @param   len - Length of data to write.
+ * @param  *buf - Data to write.
+ *
+ * @return  OSAL_SUCCESS if successful, NV_ITEM_UNINIT if item did not
+ *          exist in NV and offset is non-zero, NV_OPER_FAILED if failure.
+ */
+uint8_t osal_nv_write( uint16_t id, uint16_t ndx, uint16_t len, void *buf )
+{
+  uint8_t rtrn = OSAL_SUCCESS;
+
+  if ( len != 0 )
+  {
+    osalNvHdr_t hdr;
+    uint16_t origOff, srcOff;
+    uint16_t cnt, chk;
+    uint8_t *addr, *ptr, srcPg;
+
+    origOff = srcOff = findItem( id, &srcPg );
+    if ( srcOff == OSAL_NV_ITEM_NULL )
+    {
+      return NV_ITEM_UNINIT;
+    }
+
+    readHdr( srcPg, (srcOff - OSAL_NV_HDR_SIZE), (uint8_t *)(&hdr) );
+    if ( hdr.len < (ndx + len) )
+    {
+      return NV_OPER_FAILED;
+    }
+
+    addr = OSAL_NV_PAGE_TO_PTR( srcPg ) + srcOff + ndx;
+    ptr = buf;
+    cnt = len;
+    chk = 0;
+    while ( cnt-- )
+    {
+      if ( *addr != *ptr )
+      {
+        chk += 1;  // Count number of different bytes
+        // Calculate expected checksum after transferring old data and writing new data.
+        hdr.chk -= *addr;
+        hdr.chk += *ptr;
+      }
+      addr++;
+      ptr++;
+    }
+
+    if ( chk != 0 )  // If the buffer to write is different in one or more bytes.
+    {
+      uint8_t comPg = OSAL_NV_PAGE_NULL;
+      uint8_t dstPg = initItem( FALSE, id, hdr.len, &comPg );
+
+      if ( dstPg != OSAL_NV_PAGE_NULL )
+      {
+        uint16_t tmp = OSAL_NV_DATA_SIZE( hdr.len );
+        uint16_t dstOff = pgOff[dstPg] - tmp;
+        srcOff = origOff;
+        chk = hdr.chk;
+
+        /* Prevent excessive re-writes to item header caused by numerous, rapid,
+         * and successive OSAL_Nv interruptions caused by resets.
+         */
+        if ( hdr.stat == OSAL_NV_ERASED_ID )
+        {
+          setItem( srcPg, srcOff, eNvXfer );
+        }
+
+        xferBuf( srcPg, srcOff, dstPg, dstOff, ndx );
+        srcOff += ndx;
+        dstOff += ndx;
+
+        writeBuf( dstPg, dstOff, len, buf );
+        srcOff += len;
+        dstOff += len;
+
+        xferBuf( srcPg, srcOff, dstPg, dstOff, (hdr.len-ndx-len) );
+
+        // Calculate and write the new checksum.
+        dstOff = pgOff[dstPg] - tmp;
+        hdrData[0] = calcChkF( dstPg, dstOff, hdr.len );
+        dstOff -= OSAL_NV_HDR_SIZE;
+        flashWrite(OSAL_NV_PAGE_TO_PTR(dstPg) + dstOff + OSAL_NV_HDR_CHK,
+                   OSAL_NV_HDR_ITEM, (uint8_t *)(hdrData));
+        readHdr( dstPg, dstOff, (uint8_t *)(&hdr) );
+
+        if ( chk != hdr.chk )
+        {
+          rtrn = NV_OPER_FAILED;
         }
         else
         {
-          hotItemUpdate(dstPg, dstOff+OSAL_NV_HDR_SIZE, hdr.id);
+          itemUpdate(dstPg, dstOff+OSAL_NV_HDR_SIZE, hdr.id);
         }
       }
       else
@@ -1354,17 +2103,30 @@ uint8_t osal_nv_read( uint16_t id, uint16_t ndx, uint16_t len, void *buf )
   uint8_t *addr, *ptr = (uint8_t *)buf;
   uint8_t findPg;
   uint16_t offset;
-  uint8_t hotIdx;
+#if ( OSAL_NV_CACHE_MAX > 0 )
+  osalNvCache_t *ent = nvCacheLookup( id );
+
+  if ( ent == NULL )
+  {
+    return NV_OPER_FAILED;
+  }
 
-  if ((hotIdx = hotItem(id)) < OSAL_NV_MAX_HOT)
+#if ( OSAL_NV_CACHE_DATA_LEN > 0 )
+  if ( (ent->len <= OSAL_NV_CACHE_DATA_LEN) && ((ndx + len) <= ent->len) )
   {
-    findPg = hotPg[hotIdx];
-    offset = hotOff[hotIdx];
+    osal_memcpy( buf, (ent->data + ndx), len );
+    return OSAL_SUCCESS;
   }
-  else if ((offset = findItem(id, &findPg)) == OSAL_NV_ITEM_NULL)
+#endif
+
+  findPg = ent->pg;
+  offset = ent->off;
+#else
+  if ((offset = findItem(id, &findPg)) == OSAL_NV_ITEM_NULL)
   {
     return NV_OPER_FAILED;
   }
+#endif
 
   addr = OSAL_NV_PAGE_TO_PTR(findPg) + offset + ndx;
   while ( len-- )
@@ -1411,6 +2173,12 @@ uint8_t osal_nv_delete( uint16_t id, uint16_t len )
 
   // Set item header ID to zero to 'delete' the item
   setItem( findPg, offset, eNvZero );
+#if ( OSAL_NV_INDEX_MAX > 0 )
+  nvIndexRemove( id );
+#endif
+#if ( OSAL_NV_CACHE_MAX > 0 )
+  nvCacheRemove( id );
+#endif
 
   // Verify that item has been removed
   offset = findItem( id, &findPg );
@@ -1426,5 +2194,280 @@ uint8_t osal_nv_delete( uint16_t id, uint16_t len )
   }
 }
 
+/******************************************************************************
+ * @fn      osal_nv_txn_begin
+ *
+ * @brief   Open a transaction. The items written with osal_nv_txn_write()
+ *          are staged in RAM and all reach NV together, or none of them
+ *          do, when osal_nv_txn_commit() is called.
+ *
+ * @param   none
+ *
+ * @return  OSAL_SUCCESS if the transaction was opened,
+ *          NV_OPER_FAILED if a transaction is already open.
+ */
+uint8_t osal_nv_txn_begin( void )
+{
+  if ( nvTxnOpen )
+  {
+    return NV_OPER_FAILED;
+  }
+
+  nvTxnOpen = TRUE;
+
+  return OSAL_SUCCESS;
+}
+
+/******************************************************************************
+ * @fn      osal_nv_txn_write
+ *
+ * @brief   Stage a write of an item, or of an element of it, in the open
+ *          transaction. The item is copied to RAM the first time it is
+ *          written; osal_nv_read() returns the value in NV until commit.
+ *
+ * @param   id  - Valid NV item Id.
+ * @param   ndx - Index offset into item
+ * @param   len - Length of data to write.
+ * @param  *buf - Data to write.
+ *
+ * @return  OSAL_SUCCESS if the write was staged,
+ *          NV_ITEM_UNINIT if the item does not exist in NV,
+ *          NV_OPER_FAILED if no transaction is open, the write does not
+ *          fit the item or no memory is left to stage it.
+ */
+uint8_t osal_nv_txn_write( uint16_t id, uint16_t ndx, uint16_t len, void *buf )
+{
+  osalNvTxnItem_t *item, **link;
+
+  if ( !nvTxnOpen )
+  {
+    return NV_OPER_FAILED;
+  }
+
+  for ( link = &nvTxnHead; (item = *link) != NULL; link = &item->next )
+  {
+    if ( item->id == id )
+    {
+      break;
+    }
+  }
+
+  if ( item == NULL )
+  {
+    osalNvHdr_t hdr;
+    uint16_t offset;
+    uint8_t findPg;
+
+    if ( (offset = findItem( id, &findPg )) == OSAL_NV_ITEM_NULL )
+    {
+      return NV_ITEM_UNINIT;
+    }
+
+    readHdr( findPg, (offset - OSAL_NV_HDR_SIZE), (uint8_t *)(&hdr) );
+
+    item = osal_mem_alloc( sizeof( osalNvTxnItem_t ) + hdr.len );
+    if ( item == NULL )
+    {
+      return NV_OPER_FAILED;
+    }
+
+    item->next = NULL;
+    item->id = id;
+    item->len = hdr.len;
+    osal_memcpy( OSAL_NV_TXN_DATA( item ), (OSAL_NV_PAGE_TO_PTR( findPg ) + offset), hdr.len );
+    *link = item;
+  }
+
+  if ( (ndx + len) > item->len )
+  {
+    return NV_OPER_FAILED;
+  }
+
+  osal_memcpy( (OSAL_NV_TXN_DATA( item ) + ndx), buf, len );
+
+  return OSAL_SUCCESS;
+}
+
+/******************************************************************************
+ * @fn      osal_nv_txn_commit
+ *
+ * @brief   Write the items staged by the open transaction and close it.
+ *          The changed items are appended to one page in a single run,
+ *          followed by a commit record. Until that record is written a
+ *          power-cycle leaves every item as it was; after it, initNV()
+ *          finishes the commit.
+ *
+ * @param   none
+ *
+ * @return  OSAL_SUCCESS if all the items were written, or none had changed,
+ *          NV_ITEM_UNINIT if a staged item was deleted meanwhile,
+ *          NV_BAD_ITEM_LEN if a staged item was re-created with another length,
+ *          NV_OPER_FAILED if no transaction is open or the write failed;
+ *          no item is changed then.
+ */
+uint8_t osal_nv_txn_commit( void )
+{
+  osalNvTxnItem_t *item;
+  osalNvHdr_t hdr;
+  uint16_t sz = 0;
+  uint16_t recOff;
+  uint8_t rtrn = OSAL_SUCCESS;
+  uint8_t pg;
+
+  if ( !nvTxnOpen )
+  {
+    return NV_OPER_FAILED;
+  }
+
+  // Check the staged items against NV and skip the unchanged ones.
+  for ( item = nvTxnHead; (item != NULL) && (rtrn == OSAL_SUCCESS); item = item->next )
+  {
+    item->dstOff = OSAL_NV_ITEM_NULL;
+    item->srcOff = findItem( item->id, &item->srcPg );
+
+    if ( item->srcOff == OSAL_NV_ITEM_NULL )
+    {
+      rtrn = NV_ITEM_UNINIT;
+    }
+    else
+    {
+      readHdr( item->srcPg, (item->srcOff - OSAL_NV_HDR_SIZE), (uint8_t *)(&hdr) );
+
+      if ( hdr.len != item->len )
+      {
+        rtrn = NV_BAD_ITEM_LEN;
+      }
+      else if ( osal_memcmp( (OSAL_NV_PAGE_TO_PTR( item->srcPg ) + item->srcOff),
+                             OSAL_NV_TXN_DATA( item ), item->len ) )
+      {
+        item->srcOff = OSAL_NV_ITEM_NULL;
+      }
+      else
+      {
+        sz += OSAL_NV_ITEM_SIZE( item->len );
+      }
+    }
+  }
+
+  if ( (rtrn != OSAL_SUCCESS) || (sz == 0) )
+  {
+    osal_nv_txn_abort();
+    return rtrn;
+  }
+
+  // Any compaction is done before the run starts, and may move the current copies.
+  pg = txnPage( sz + OSAL_NV_HDR_SIZE );
+  if ( pg == OSAL_NV_PAGE_NULL )
+  {
+    osal_nv_txn_abort();
+    return NV_OPER_FAILED;
+  }
+
+  // Append the run, each item carrying the transaction mark in its Id.
+  for ( item = nvTxnHead; item != NULL; item = item->next )
+  {
+    if ( item->srcOff != OSAL_NV_ITEM_NULL )
+    {
+      item->srcOff = findItem( item->id, &item->srcPg );
+      item->dstOff = pgOff[pg] + OSAL_NV_HDR_SIZE;
+
+      if ( !writeItem( pg, (item->id | OSAL_NV_TXN_ITEM), item->len, OSAL_NV_TXN_DATA( item ), TRUE ) )
+      {
+        rtrn = NV_OPER_FAILED;
+        break;
+      }
+    }
+  }
+
+  recOff = pgOff[pg];
+
+  if ( rtrn == OSAL_SUCCESS )
+  {
+    // The checksum of the zero-length commit record is the commit point.
+    hdr.id = OSAL_NV_TXN_ID;
+    hdr.len = 0;
+    flashWrite(OSAL_NV_PAGE_TO_PTR(pg) + recOff + OSAL_NV_HDR_ID,
+               OSAL_NV_HDR_ITEM, (uint8_t *)(&hdr));
+    hdrData[0] = 0;
+    flashWrite(OSAL_NV_PAGE_TO_PTR(pg) + recOff + OSAL_NV_HDR_CHK,
+               OSAL_NV_HDR_ITEM, (uint8_t *)(hdrData));
+    readHdr( pg, recOff, (uint8_t *)(&hdr) );
+    pgOff[pg] += OSAL_NV_HDR_SIZE;
+
+    if ( (hdr.id != OSAL_NV_TXN_ID) || (hdr.len != 0) || (hdr.chk != 0) )
+    {
+      rtrn = NV_OPER_FAILED;
+    }
+  }
+
+  for ( item = nvTxnHead; item != NULL; item = item->next )
+  {
+    if ( item->dstOff != OSAL_NV_ITEM_NULL )
+    {
+      if ( rtrn == OSAL_SUCCESS )
+      {
+        setItem( item->srcPg, item->srcOff, eNvZero );
+        itemUpdate( pg, item->dstOff, item->id );
+      }
+      else
+      {
+        // Roll back the part of the run that was written.
+        setItem( pg, item->dstOff, eNvZero );
+      }
+    }
+  }
+
+  // Zeroed last, the run is settled.
+  if ( recOff < pgOff[pg] )
+  {
+    setItem( pg, recOff + OSAL_NV_HDR_SIZE, eNvZero );
+  }
+
+  osal_nv_txn_abort();
+
+  return rtrn;
+}
+
+/******************************************************************************
+ * @fn      osal_nv_txn_abort
+ *
+ * @brief   Close the open transaction and drop the items it staged.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osal_nv_txn_abort( void )
+{
+  osalNvTxnItem_t *item;
+
+  while ( (item = nvTxnHead) != NULL )
+  {
+    nvTxnHead = item->next;
+    osal_mem_free( item );
+  }
+
+  nvTxnOpen = FALSE;
+}
+
+/******************************************************************************
+ * @fn      osal_nv_cache_stats
+ *
+ * @brief   Get the statistics of the cache of the most used NV items. The
+ *          counts are all zero if the cache is disabled.
+ *
+ * @param   stats - Buffer for the statistics.
+ *
+ * @return  none
+ */
+void osal_nv_cache_stats( osalNvCacheStats_t *stats )
+{
+#if ( OSAL_NV_CACHE_MAX > 0 )
+  *stats = nvCacheStats;
+#else
+  osal_memset( stats, 0, sizeof( osalNvCacheStats_t ) );
+#endif
+}
+
 /*********************************************************************
  */
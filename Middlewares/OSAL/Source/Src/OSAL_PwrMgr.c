@@ -49,6 +49,9 @@ extern void halSleep( uint32_t osal_timeout );
  * LOCAL VARIABLES
  */
 
+// Sleeps ended by an OSAL timer
+static uint32_t pwrmgrWakeups;
+
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
  */
@@ -152,9 +155,24 @@ void osal_pwrmgr_powerconserve( void )
       // Hold off interrupts.
       HAL_ENTER_CRITICAL_SECTION( intState );
 
+#ifdef USE_SYSTICK_IRQ
+      // Ticks counted since the timers were updated may expire one,
+      // the OSAL loop has to apply them first.
+      if ( osalTickPending() )
+      {
+        HAL_EXIT_CRITICAL_SECTION( intState );
+        return;
+      }
+#endif
+
       // Get next time-out
       next = osal_next_timeout();
 
+      if ( next != 0 )
+      {
+        pwrmgrWakeups++;
+      }
+
       // Re-enable interrupts.
       HAL_EXIT_CRITICAL_SECTION( intState );
 
@@ -163,6 +181,21 @@ void osal_pwrmgr_powerconserve( void )
     }
   }
 }
+
+/*********************************************************************
+ * @fn      osal_pwrmgr_wakeups
+ *
+ * @brief   Return the number of sleeps that were timed to end with an
+ *          OSAL timer, to compare wakeup rates.
+ *
+ * @param   none.
+ *
+ * @return  number of timed sleeps
+ */
+uint32_t osal_pwrmgr_wakeups( void )
+{
+  return ( pwrmgrWakeups );
+}
 #endif /* POWER_SAVING */
 
 /*********************************************************************
@@ -0,0 +1,247 @@
+/**************************************************************************************************
+  Filename:       OSAL_Slab.c
+  Revised:        $Date$
+  Revision:       $Revision$
+
+  Description:    OSAL fixed-size object caches. Each slab keeps the free objects of its
+                  pool on a singly linked list threaded through the objects themselves.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "OSAL.h"
+
+#include "OSAL_Memory.h"
+#include "OSAL_Slab.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// Free list link stored in the first bytes of a free object
+#define SLAB_LINK( obj )        (*(void **)(obj))
+
+// Object lies inside the slab's static pool
+#define SLAB_IN_POOL( slab, obj ) \
+  (((uint8_t *)(obj) >= (slab)->pool) && \
+   ((uint8_t *)(obj) < (slab)->pool + ((uint32_t)(slab)->objSize * (slab)->objCnt)))
+
+// Count an allocated object and track the high-water mark
+#define SLAB_COUNT_USED( slab ) \
+  st( if ( ++(slab)->used > (slab)->maxUsed ) { (slab)->maxUsed = (slab)->used; } )
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// List of all registered slabs
+static osalSlab_t *slabHead;
+
+/*********************************************************************
+ * FUNCTIONS
+ *********************************************************************/
+
+/*********************************************************************
+ * @fn      osal_slab_init
+ *
+ * @brief   Initialize a slab over a statically reserved pool and link
+ *          it into the list of registered slabs.
+ *
+ * @param   slab - slab to initialize
+ * @param   name - name reported with the statistics
+ * @param   pool - object storage, see OSAL_SLAB_POOL()
+ * @param   objSize - object size, see OSAL_SLAB_OBJ_SIZE()
+ * @param   objCnt - number of objects in the pool
+ * @param   flags - OSAL_SLAB_xxx option flags
+ *
+ * @return  none
+ */
+void osal_slab_init( osalSlab_t *slab, const char *name, void *pool,
+                     uint16_t objSize, uint16_t objCnt, uint8_t flags )
+{
+  halIntState_t intState;
+  osalSlab_t *srch;
+  uint8_t *obj;
+  uint16_t idx;
+
+  HAL_ASSERT( (objSize >= sizeof( void * )) && ((objSize % sizeof( halDataAlign_t )) == 0) );
+
+  slab->name = name;
+  slab->pool = pool;
+  slab->objSize = objSize;
+  slab->objCnt = objCnt;
+  slab->used = 0;
+  slab->maxUsed = 0;
+  slab->heapCnt = 0;
+  slab->failCnt = 0;
+  slab->flags = flags;
+
+  // Thread all objects onto the free list, lowest address first
+  slab->freeList = NULL;
+  obj = slab->pool + ((uint32_t)objSize * objCnt);
+  for ( idx = 0; idx < objCnt; idx++ )
+  {
+    obj -= objSize;
+    SLAB_LINK( obj ) = slab->freeList;
+    slab->freeList = obj;
+  }
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  // Register the slab once, re-initialization keeps its place in the list
+  for ( srch = slabHead; srch != NULL; srch = srch->next )
+  {
+    if ( srch == slab )
+    {
+      break;
+    }
+  }
+
+  if ( srch == NULL )
+  {
+    slab->next = slabHead;
+    slabHead = slab;
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+}
+
+/*********************************************************************
+ * @fn      osal_slab_alloc
+ *
+ * @brief   Allocate an object from a slab. When the pool is exhausted
+ *          and the slab was created with OSAL_SLAB_HEAP_FALLBACK, the
+ *          object is taken from the OSAL heap instead.
+ *
+ * @param   slab - slab to allocate from
+ *
+ * @return  pointer to the object, NULL if none is available
+ */
+void *osal_slab_alloc( osalSlab_t *slab )
+{
+  halIntState_t intState;
+  void *obj;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  obj = slab->freeList;
+  if ( obj != NULL )
+  {
+    slab->freeList = SLAB_LINK( obj );
+    SLAB_COUNT_USED( slab );
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  if ( obj == NULL )
+  {
+    if ( slab->flags & OSAL_SLAB_HEAP_FALLBACK )
+    {
+      obj = osal_mem_alloc( slab->objSize );
+    }
+
+    HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+    if ( obj != NULL )
+    {
+      slab->heapCnt++;
+      SLAB_COUNT_USED( slab );
+    }
+    else
+    {
+      slab->failCnt++;
+    }
+
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+  }
+
+  return ( obj );
+}
+
+/*********************************************************************
+ * @fn      osal_slab_free
+ *
+ * @brief   Return an object to its slab, or to the heap if it was a
+ *          heap fallback allocation.
+ *
+ * @param   slab - slab the object was allocated from
+ * @param   obj - object to free
+ *
+ * @return  none
+ */
+void osal_slab_free( osalSlab_t *slab, void *obj )
+{
+  halIntState_t intState;
+
+  if ( obj == NULL )
+  {
+    return;
+  }
+
+  if ( SLAB_IN_POOL( slab, obj ) )
+  {
+    HAL_ASSERT( (((uint8_t *)obj - slab->pool) % slab->objSize) == 0 );
+
+    HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+    SLAB_LINK( obj ) = slab->freeList;
+    slab->freeList = obj;
+    slab->used--;
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+  }
+  else
+  {
+    HAL_ASSERT( slab->heapCnt != 0 );
+
+    osal_mem_free( obj );
+
+    HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+    slab->heapCnt--;
+    slab->used--;
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+  }
+}
+
+/*********************************************************************
+ * @fn      osal_slab_stats
+ *
+ * @brief   Copy the usage statistics of a slab.
+ *
+ * @param   slab - slab to report
+ * @param   stats - buffer for the statistics
+ *
+ * @return  none
+ */
+void osal_slab_stats( osalSlab_t *slab, osalSlabStats_t *stats )
+{
+  halIntState_t intState;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  stats->name = slab->name;
+  stats->objSize = slab->objSize;
+  stats->objCnt = slab->objCnt;
+  stats->used = slab->used;
+  stats->maxUsed = slab->maxUsed;
+  stats->heapCnt = slab->heapCnt;
+  stats->failCnt = slab->failCnt;
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+}
+
+/*********************************************************************
+ * @fn      osal_slab_next
+ *
+ * @brief   Iterate over the registered slabs.
+ *
+ * @param   slab - current slab, NULL to start with the first one
+ *
+ * @return  next registered slab, NULL at the end of the list
+ */
+osalSlab_t *osal_slab_next( osalSlab_t *slab )
+{
+  return ( (slab == NULL) ? slabHead : slab->next );
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -0,0 +1,624 @@
+/**************************************************************************************************
+  Filename:       OSAL_Sync.c
+  Revised:        $Date$
+  Revision:       $Revision$
+
+  Description:    OSAL counting semaphores and event groups. Each object keeps its waiters
+                  on a list of records from a static pool. A waiter is notified with its
+                  own task event, its timeout runs on an OSAL timer for that event, and the
+                  task learns the outcome by calling take or wait again from the event.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include "OSAL.h"
+
+#include "OSAL_Timers.h"
+#include "OSAL_Slab.h"
+#include "OSAL_Sync.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Number of waiter records, the most tasks waiting at the same time on
+// all semaphores and event groups
+#if !defined OSAL_SYNC_WAITERS_MAX
+  #define OSAL_SYNC_WAITERS_MAX  8
+#endif
+
+// Waiter states
+#define SYNC_WAITING            0  // Waiting, the event is raised on wakeup
+#define SYNC_GRANTED            1  // Woken, the next take or wait returns success
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct osalSyncWaiter
+{
+  struct osalSyncWaiter *next;
+  uint64_t expire;              // osal_GetSystemClock64() timeout, 0 waits forever
+  uint16_t event_flag;
+  uint16_t bits;                // Bits waited for, the matching bits once granted
+  uint8_t  task_id;
+  uint8_t  options;             // OSAL_EVGRP_xxx wait options
+  uint8_t  state;               // SYNC_xxx
+} osalSyncWaiter_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Waiter record pool
+static osalSlab_t syncSlab;
+static OSAL_SLAB_POOL( syncPool, osalSyncWaiter_t, OSAL_SYNC_WAITERS_MAX );
+
+/*********************************************************************
+ * LOCAL FUNCTION PROTOTYPES
+ */
+static osalSyncWaiter_t **syncFind( osalSyncWaiter_t **link, uint8_t task_id, uint16_t event_flag );
+static uint8_t syncResult( osalSyncWaiter_t **link );
+static uint8_t syncQueue( osalSyncWaiter_t **link, uint8_t task_id, uint16_t event_flag,
+                          uint32_t timeout, uint16_t bits, uint8_t options );
+static void syncGrant( osalSyncWaiter_t *waiter );
+static uint8_t semGive( osalSem_t *sem );
+
+/*********************************************************************
+ * FUNCTIONS
+ *********************************************************************/
+
+/*********************************************************************
+ * @fn      osalSyncInit
+ *
+ * @brief   Initialization for the OSAL semaphores and event groups.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void osalSyncInit( void )
+{
+  osal_slab_init( &syncSlab, "sync", syncPool, OSAL_SLAB_OBJ_SIZE( osalSyncWaiter_t ),
+                  OSAL_SYNC_WAITERS_MAX, 0 );
+}
+
+/*********************************************************************
+ * @fn      syncFind
+ *
+ * @brief   Find the waiter record of a (task, event) on a list.
+ *          Ints must be disabled.
+ *
+ * @param   link - head of the waiter list
+ * @param   task_id
+ * @param   event_flag
+ *
+ * @return  link pointing to the record, NULL if not found
+ */
+static osalSyncWaiter_t **syncFind( osalSyncWaiter_t **link, uint8_t task_id, uint16_t event_flag )
+{
+  for ( ; *link != NULL; link = &(*link)->next )
+  {
+    if ( ((*link)->task_id == task_id) && ((*link)->event_flag == event_flag) )
+    {
+      return ( link );
+    }
+  }
+
+  return ( NULL );
+}
+
+/*********************************************************************
+ * @fn      syncResult
+ *
+ * @brief   Report the outcome of a wait to its task. A granted or timed
+ *          out record is taken off the list and freed, and the timeout
+ *          of a granted wait is stopped.
+ *          Ints must be disabled.
+ *
+ * @param   link - link pointing to the waiter record
+ *
+ * @return  OSAL_SUCCESS, OSAL_SYNC_TIMEOUT or OSAL_SYNC_PENDING
+ */
+static uint8_t syncResult( osalSyncWaiter_t **link )
+{
+  osalSyncWaiter_t *waiter = *link;
+  uint8_t status;
+
+  if ( waiter->state == SYNC_WAITING )
+  {
+    if ( (waiter->expire == 0) || (osal_GetSystemClock64() < waiter->expire) )
+    {
+      return ( OSAL_SYNC_PENDING );
+    }
+  }
+
+  if ( waiter->state == SYNC_GRANTED )
+  {
+    if ( waiter->expire != 0 )
+    {
+      (void)osal_stop_timerEx( waiter->task_id, waiter->event_flag );
+    }
+    status = OSAL_SUCCESS;
+  }
+  else
+  {
+    status = OSAL_SYNC_TIMEOUT;
+  }
+
+  *link = waiter->next;
+  osal_slab_free( &syncSlab, waiter );
+
+  return ( status );
+}
+
+/*********************************************************************
+ * @fn      syncQueue
+ *
+ * @brief   Queue a task at the end of a waiter list and start the timer
+ *          of its timeout on the task event.
+ *          Ints must be disabled.
+ *
+ * @param   link - head of the waiter list
+ * @param   task_id
+ * @param   event_flag
+ * @param   timeout - in milliseconds, OSAL_SYNC_FOREVER for none
+ * @param   bits - event group bits to wait for
+ * @param   options - OSAL_EVGRP_xxx wait options
+ *
+ * @return  OSAL_SYNC_PENDING, OSAL_FAILURE if no waiter record is free
+ *          or NO_TIMER_AVAIL
+ */
+static uint8_t syncQueue( osalSyncWaiter_t **link, uint8_t task_id, uint16_t event_flag,
+                          uint32_t timeout, uint16_t bits, uint8_t options )
+{
+  osalSyncWaiter_t *waiter;
+
+  waiter = osal_slab_alloc( &syncSlab );
+  if ( waiter == NULL )
+  {
+    return ( OSAL_FAILURE );
+  }
+
+  waiter->next = NULL;
+  waiter->expire = 0;
+  waiter->event_flag = event_flag;
+  waiter->bits = bits;
+  waiter->task_id = task_id;
+  waiter->options = options;
+  waiter->state = SYNC_WAITING;
+
+  if ( timeout != OSAL_SYNC_FOREVER )
+  {
+    if ( osal_start_timerEx( task_id, event_flag, timeout ) != OSAL_SUCCESS )
+    {
+      osal_slab_free( &syncSlab, waiter );
+      return ( NO_TIMER_AVAIL );
+    }
+    waiter->expire = osal_GetSystemClock64() + timeout;
+  }
+
+  while ( *link != NULL )
+  {
+    link = &(*link)->next;
+  }
+  *link = waiter;
+
+  return ( OSAL_SYNC_PENDING );
+}
+
+/*********************************************************************
+ * @fn      syncGrant
+ *
+ * @brief   Wake a waiter - raise its event. The record stays on the
+ *          list until the task collects the result, which also stops
+ *          the timeout, so that waking does not touch the timers from
+ *          interrupts. Ints must be disabled.
+ *
+ * @param   waiter - waiting record
+ *
+ * @return  none
+ */
+static void syncGrant( osalSyncWaiter_t *waiter )
+{
+  waiter->state = SYNC_GRANTED;
+
+  (void)osal_set_event( waiter->task_id, waiter->event_flag );
+}
+
+/*********************************************************************
+ * @fn      osal_sem_init
+ *
+ * @brief   Initialize a counting semaphore with no waiters.
+ *
+ * @param   sem - semaphore
+ * @param   count - units available
+ * @param   max - highest count
+ *
+ * @return  none
+ */
+void osal_sem_init( osalSem_t *sem, uint16_t count, uint16_t max )
+{
+  sem->count = (count < max) ? count : max;
+  sem->max = max;
+  sem->waiters = NULL;
+}
+
+/*********************************************************************
+ * @fn      osal_sem_take
+ *
+ * @brief   Take a unit of a semaphore. If none is available the task
+ *          is queued and 'event_id' is raised once a unit is handed to
+ *          it or the timeout elapses. The task then calls osal_sem_take()
+ *          again with the same task and event to collect the result.
+ *          The event should be used for this wait only.
+ *
+ * @param   sem - semaphore
+ * @param   task_id - waiting task
+ * @param   event_id - event raised on wakeup
+ * @param   timeout - in milliseconds, 0 does not wait, OSAL_SYNC_FOREVER
+ *                    never times out
+ *
+ * @return  OSAL_SUCCESS if the unit is taken, OSAL_SYNC_PENDING while
+ *          waiting, OSAL_SYNC_TIMEOUT, OSAL_FAILURE if no waiter record
+ *          is free or NO_TIMER_AVAIL
+ */
+uint8_t osal_sem_take( osalSem_t *sem, uint8_t task_id, uint16_t event_id, uint32_t timeout )
+{
+  halIntState_t intState;
+  osalSyncWaiter_t **link;
+  uint8_t status;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  link = syncFind( &sem->waiters, task_id, event_id );
+  if ( link != NULL )
+  {
+    status = syncResult( link );
+  }
+  else if ( sem->count != 0 )
+  {
+    // Units are only left over when nobody waits
+    sem->count--;
+    status = OSAL_SUCCESS;
+  }
+  else if ( timeout == 0 )
+  {
+    status = OSAL_SYNC_TIMEOUT;
+  }
+  else
+  {
+    status = syncQueue( &sem->waiters, task_id, event_id, timeout, 0, 0 );
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( status );
+}
+
+/*********************************************************************
+ * @fn      semGive
+ *
+ * @brief   Hand a unit to the first waiter or count it.
+ *          Ints must be disabled.
+ *
+ * @param   sem - semaphore
+ *
+ * @return  OSAL_SUCCESS or OSAL_FAILURE if the count is at its maximum
+ */
+static uint8_t semGive( osalSem_t *sem )
+{
+  osalSyncWaiter_t *waiter;
+
+  for ( waiter = sem->waiters; waiter != NULL; waiter = waiter->next )
+  {
+    if ( waiter->state == SYNC_WAITING )
+    {
+      syncGrant( waiter );
+      return ( OSAL_SUCCESS );
+    }
+  }
+
+  if ( sem->count >= sem->max )
+  {
+    return ( OSAL_FAILURE );
+  }
+
+  sem->count++;
+
+  return ( OSAL_SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      osal_sem_give
+ *
+ * @brief   Give a unit back to a semaphore. The first waiting task gets
+ *          the unit and its event is raised, otherwise the count is
+ *          increased. May be called from interrupts.
+ *
+ * @param   sem - semaphore
+ *
+ * @return  OSAL_SUCCESS or OSAL_FAILURE if the count is at its maximum
+ */
+uint8_t osal_sem_give( osalSem_t *sem )
+{
+  halIntState_t intState;
+  uint8_t status;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+  status = semGive( sem );
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( status );
+}
+
+/*********************************************************************
+ * @fn      osal_sem_cancel
+ *
+ * @brief   Stop waiting for a semaphore. A unit that was already handed
+ *          to the task is given back.
+ *
+ * @param   sem - semaphore
+ * @param   task_id - waiting task
+ * @param   event_id - event of the wait
+ *
+ * @return  OSAL_SUCCESS or INVALID_EVENT_ID if the task does not wait
+ */
+uint8_t osal_sem_cancel( osalSem_t *sem, uint8_t task_id, uint16_t event_id )
+{
+  halIntState_t intState;
+  osalSyncWaiter_t **link;
+  osalSyncWaiter_t *waiter;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  link = syncFind( &sem->waiters, task_id, event_id );
+  if ( link == NULL )
+  {
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+    return ( INVALID_EVENT_ID );
+  }
+
+  waiter = *link;
+  *link = waiter->next;
+
+  if ( waiter->state == SYNC_GRANTED )
+  {
+    (void)semGive( sem );
+  }
+
+  if ( waiter->expire != 0 )
+  {
+    (void)osal_stop_timerEx( task_id, event_id );
+  }
+
+  osal_slab_free( &syncSlab, waiter );
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( OSAL_SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      osal_evgrp_init
+ *
+ * @brief   Initialize an event group with no bits set and no waiters.
+ *
+ * @param   grp - event group
+ *
+ * @return  none
+ */
+void osal_evgrp_init( osalEventGroup_t *grp )
+{
+  grp->bits = 0;
+  grp->waiters = NULL;
+}
+
+/*********************************************************************
+ * @fn      osal_evgrp_set
+ *
+ * @brief   Set bits of an event group. Every waiter whose condition is
+ *          now met is woken with its event, the bits of waiters that
+ *          asked for OSAL_EVGRP_CLEAR are cleared afterwards. May be
+ *          called from interrupts.
+ *
+ * @param   grp - event group
+ * @param   bits - bits to set
+ *
+ * @return  OSAL_SUCCESS
+ */
+uint8_t osal_evgrp_set( osalEventGroup_t *grp, uint16_t bits )
+{
+  halIntState_t intState;
+  osalSyncWaiter_t *waiter;
+  uint16_t match;
+  uint16_t clear = 0;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  grp->bits |= bits;
+
+  for ( waiter = grp->waiters; waiter != NULL; waiter = waiter->next )
+  {
+    if ( waiter->state != SYNC_WAITING )
+    {
+      continue;
+    }
+
+    match = grp->bits & waiter->bits;
+    if ( (waiter->options & OSAL_EVGRP_ALL) ? (match == waiter->bits) : (match != 0) )
+    {
+      waiter->bits = match;
+      if ( waiter->options & OSAL_EVGRP_CLEAR )
+      {
+        clear |= match;
+      }
+      syncGrant( waiter );
+    }
+  }
+
+  grp->bits &= ~clear;
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( OSAL_SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      osal_evgrp_clear
+ *
+ * @brief   Clear bits of an event group.
+ *
+ * @param   grp - event group
+ * @param   bits - bits to clear
+ *
+ * @return  none
+ */
+void osal_evgrp_clear( osalEventGroup_t *grp, uint16_t bits )
+{
+  halIntState_t intState;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+  grp->bits &= ~bits;
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+}
+
+/*********************************************************************
+ * @fn      osal_evgrp_get
+ *
+ * @brief   Read the bits of an event group.
+ *
+ * @param   grp - event group
+ *
+ * @return  bits currently set
+ */
+uint16_t osal_evgrp_get( osalEventGroup_t *grp )
+{
+  return ( grp->bits );
+}
+
+/*********************************************************************
+ * @fn      osal_evgrp_wait
+ *
+ * @brief   Wait for any or all of 'bits' in an event group. If the
+ *          condition is not met the task is queued and 'event_id' is
+ *          raised once it is met or the timeout elapses. The task then
+ *          calls osal_evgrp_wait() again with the same task and event to
+ *          collect the result. The event should be used for this wait
+ *          only.
+ *
+ * @param   grp - event group
+ * @param   bits - bits to wait for
+ * @param   options - OSAL_EVGRP_ANY or OSAL_EVGRP_ALL, with
+ *                    OSAL_EVGRP_CLEAR to clear the matching bits
+ * @param   task_id - waiting task
+ * @param   event_id - event raised on wakeup
+ * @param   timeout - in milliseconds, 0 does not wait, OSAL_SYNC_FOREVER
+ *                    never times out
+ * @param   result - bits that met the condition on success, may be NULL
+ *
+ * @return  OSAL_SUCCESS if the condition is met, OSAL_SYNC_PENDING while
+ *          waiting, OSAL_SYNC_TIMEOUT, INVALIDPARAMETER, OSAL_FAILURE if
+ *          no waiter record is free or NO_TIMER_AVAIL
+ */
+uint8_t osal_evgrp_wait( osalEventGroup_t *grp, uint16_t bits, uint8_t options,
+                         uint8_t task_id, uint16_t event_id, uint32_t timeout,
+                         uint16_t *result )
+{
+  halIntState_t intState;
+  osalSyncWaiter_t **link;
+  uint16_t match = 0;
+  uint8_t status;
+
+  if ( bits == 0 )
+  {
+    return ( INVALIDPARAMETER );
+  }
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  link = syncFind( &grp->waiters, task_id, event_id );
+  if ( link != NULL )
+  {
+    match = (*link)->bits;
+    status = syncResult( link );
+  }
+  else
+  {
+    match = grp->bits & bits;
+    if ( (options & OSAL_EVGRP_ALL) ? (match == bits) : (match != 0) )
+    {
+      if ( options & OSAL_EVGRP_CLEAR )
+      {
+        grp->bits &= ~match;
+      }
+      status = OSAL_SUCCESS;
+    }
+    else if ( timeout == 0 )
+    {
+      status = OSAL_SYNC_TIMEOUT;
+    }
+    else
+    {
+      status = syncQueue( &grp->waiters, task_id, event_id, timeout, bits, options );
+    }
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  if ( (status == OSAL_SUCCESS) && (result != NULL) )
+  {
+    *result = match;
+  }
+
+  return ( status );
+}
+
+/*********************************************************************
+ * @fn      osal_evgrp_cancel
+ *
+ * @brief   Stop waiting for an event group.
+ *
+ * @param   grp - event group
+ * @param   task_id - waiting task
+ * @param   event_id - event of the wait
+ *
+ * @return  OSAL_SUCCESS or INVALID_EVENT_ID if the task does not wait
+ */
+uint8_t osal_evgrp_cancel( osalEventGroup_t *grp, uint8_t task_id, uint16_t event_id )
+{
+  halIntState_t intState;
+  osalSyncWaiter_t **link;
+  osalSyncWaiter_t *waiter;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  link = syncFind( &grp->waiters, task_id, event_id );
+  if ( link == NULL )
+  {
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+    return ( INVALID_EVENT_ID );
+  }
+
+  waiter = *link;
+  *link = waiter->next;
+
+  if ( waiter->expire != 0 )
+  {
+    (void)osal_stop_timerEx( task_id, event_id );
+  }
+
+  osal_slab_free( &syncSlab, waiter );
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( OSAL_SUCCESS );
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -14,40 +14,130 @@
 #include "OSAL_PwrMgr.h"
 #include "OSAL_Timers.h"
 #include "OSAL_Memory.h"
+#include "OSAL_Slab.h"
+#include "OSAL_Tasks.h"
+#include "OSAL_Clock.h"
 
 /*********************************************************************
  * MACROS
  */
 
+// Wheel slot index of a timer at a level
+#define TIMER_WHEEL_SLOT( lvl, time ) \
+  ((uint8_t)(((time) >> ((lvl) * OSAL_TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK))
+
+// Hash bucket of a (task, event) pair - multiplicative hashing so that
+// single-bit events spread over the buckets
+#define TIMER_HASH( task_id, event_flag ) \
+  ((uint8_t)((uint16_t)(((event_flag) ^ ((uint16_t)(task_id) << 8)) * 40503u) >> (16 - OSAL_TIMER_HASH_BITS)))
+
+// Size of a timer record in the slab pool
+#define TIMER_REC_SIZE          OSAL_SLAB_OBJ_SIZE( osalTimerRec_t )
+
+// Timeout of a timer started from a task, measured from the wheel time. The
+// wheel lags the tick interrupt by the ticks osalTickProcess() has not
+// applied yet, which would otherwise shorten the timeout.
+#define TIMER_TASK_TIMEOUT( timeout )  ((timeout) + osalTickLag())
+
 /*********************************************************************
  * CONSTANTS
  */
 
+// Number of timer records in the static timer pool, the maximum number
+// of active timers. Timers never use the OSAL heap.
+#if !defined OSAL_TIMERS_MAX
+  #if defined OSAL_TIMERS_SLAB_CNT
+    #define OSAL_TIMERS_MAX  OSAL_TIMERS_SLAB_CNT
+  #else
+    #define OSAL_TIMERS_MAX  16
+  #endif
+#endif
+
+// Bits of the expiration time resolved by each level of the timing wheel.
+// The wheel uses (32 / bits) levels of (1 << bits) slots, 4 bits gives
+// 8 levels of 16 slots.
+#if !defined OSAL_TIMER_WHEEL_BITS
+  #define OSAL_TIMER_WHEEL_BITS  4
+#endif
+
+#if ( OSAL_TIMER_WHEEL_BITS != 1 ) && ( OSAL_TIMER_WHEEL_BITS != 2 ) && ( OSAL_TIMER_WHEEL_BITS != 4 )
+  #error OSAL_TIMER_WHEEL_BITS must be 1, 2 or 4.
+#endif
+
+#define TIMER_WHEEL_SLOTS   (1 << OSAL_TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS  (32 / OSAL_TIMER_WHEEL_BITS)
+
+// Buckets of the (task, event) index are 2^bits
+#if !defined OSAL_TIMER_HASH_BITS
+  #define OSAL_TIMER_HASH_BITS  4
+#endif
+
+#if ( OSAL_TIMER_HASH_BITS < 1 ) || ( OSAL_TIMER_HASH_BITS > 8 )
+  #error OSAL_TIMER_HASH_BITS must be between 1 and 8.
+#endif
+
+// Timer commands that interrupts can queue between two passes of the
+// OSAL loop, a power of two
+#if !defined OSAL_TIMER_ISR_QUEUE
+  #define OSAL_TIMER_ISR_QUEUE  8
+#endif
+
+#if ( OSAL_TIMER_ISR_QUEUE < 2 ) || ( OSAL_TIMER_ISR_QUEUE > 128 ) || \
+    ( OSAL_TIMER_ISR_QUEUE & (OSAL_TIMER_ISR_QUEUE - 1) )
+  #error OSAL_TIMER_ISR_QUEUE must be a power of two between 2 and 128.
+#endif
+
+// Timer commands from interrupts, 0 marks an entry still being written
+#define TIMER_ISR_START         1
+#define TIMER_ISR_RELOAD        2
+#define TIMER_ISR_STOP          3
+
+// Record flags used internally, above the OSAL_TIMER_xxx option flags
+#define TIMER_CBACK             0x80  // Callback timer, not in the (task, event) index
+#define TIMER_CBACK_PENDING     0x40  // Callback timer queued for dispatch
+
+#if ( OSAL_TIMERS_MAX > 0xFFFF )
+  #error OSAL_TIMERS_MAX does not fit in a timer handle.
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
 
-typedef union {
-  uint32_t time32;
-  uint16_t time16[2];
-  uint8_t time8[4];
-} osalTime_t;
+typedef struct osalTimerRec
+{
+  struct osalTimerRec  *next;
+  struct osalTimerRec **pprev;  // Link pointing to this record, NULL when not active
+  struct osalTimerRec  *hnext;  // Next record in the same hash bucket, or in the callback queue
+  uint32_t expire;              // Absolute expiration time in wheel ticks
+  uint32_t reloadTimeout;
+  uint16_t event_flag;
+  uint8_t  task_id;
+  uint8_t  slot;                // Wheel slot holding the record
+  uint16_t gen;                 // Generation of the record, bumped when it is freed
+  uint16_t slack;               // Allowed delay of the expiration, in ms
+  uint16_t delay;               // Delay of the expiration chosen within the slack
+  uint8_t  flags;               // OSAL_TIMER_xxx option flags
+  uint16_t overrun;             // Periods collapsed into a pending event, saturates
+  pfnTimerCback_t pfnCback;     // Callback of a callback timer, NULL once it is stopped
+  uint8_t *pData;               // Data passed to the callback
+} osalTimerRec_t;
 
+// Timer command queued from an interrupt
 typedef struct
 {
-  void   *next;
-  osalTime_t timeout;
+  uint32_t tick;                // osalTickCount() when it was queued
+  uint32_t timeout;
   uint16_t event_flag;
   uint8_t  task_id;
-  uint32_t reloadTimeout;
-} osalTimerRec_t;
+  volatile uint8_t op;          // TIMER_ISR_xxx, written last
+} timerIsrCmd_t;
 
 /*********************************************************************
  * GLOBAL VARIABLES
  */
 
-osalTimerRec_t *timerHead;
-
 /*********************************************************************
  * EXTERNAL VARIABLES
  */
@@ -59,8 +149,47 @@ osalTimerRec_t *timerHead;
 /*********************************************************************
  * LOCAL VARIABLES
  */
-// Milliseconds since last reboot
-static uint32_t osal_systemClock;
+// Milliseconds since last reboot, low and high words. The low word is
+// written first, see osal_GetSystemClock64().
+static volatile uint32_t osal_systemClock;
+static volatile uint32_t osal_systemClockHi;
+
+// Timer record pool
+static osalSlab_t timerSlab;
+static OSAL_SLAB_POOL( timerPool, osalTimerRec_t, OSAL_TIMERS_MAX );
+
+// Hierarchical timing wheel - a timer is kept at the level of the highest
+// bit group in which its expiration time differs from the wheel time, in
+// the slot selected by that bit group of the expiration time.
+static osalTimerRec_t *timerWheel[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+
+// Non-empty slots of each wheel level
+static uint32_t timerWheelMap[TIMER_WHEEL_LEVELS];
+
+// Slots of each wheel level holding a timer that is not deferrable
+static uint32_t timerWheelWakeMap[TIMER_WHEEL_LEVELS];
+
+// Time up to which the wheel has been processed
+static uint32_t timerWheelNow;
+
+// Number of active timers
+static uint16_t timerCnt;
+
+// Index of the active timers by (task, event)
+static osalTimerRec_t *timerHash[1 << OSAL_TIMER_HASH_BITS];
+
+// Timer commands from interrupts - entries are claimed at the head by the
+// interrupts and consumed at the tail by the OSAL loop
+static timerIsrCmd_t timerIsrQueue[OSAL_TIMER_ISR_QUEUE];
+static volatile uint8_t timerIsrHead;
+static volatile uint8_t timerIsrTail;
+
+// Expired callback timers waiting for dispatch, oldest first, and the
+// task event that dispatches them
+static osalTimerRec_t *timerCbackHead;
+static osalTimerRec_t **timerCbackTail = &timerCbackHead;
+static uint8_t timerCbackTask = TASK_NO_TASK;
+static uint16_t timerCbackEvent;
 
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
@@ -69,6 +198,19 @@ osalTimerRec_t  *osalAddTimer( uint8_t task_id, uint16_t event_flag, uint32_t ti
 osalTimerRec_t *osalFindTimer( uint8_t task_id, uint16_t event_flag );
 void osalDeleteTimer( osalTimerRec_t *rmTimer );
 
+static uint8_t timerWheelSlot( uint32_t expire );
+static void timerWheelInsert( osalTimerRec_t *tmr );
+static void timerWheelRemove( osalTimerRec_t *tmr );
+static uint8_t timerWheelNext( const uint32_t *wheelMap, uint32_t *next );
+static void timerArm( osalTimerRec_t *tmr, uint32_t timeout );
+static void timerReload( osalTimerRec_t *tmr, uint32_t target );
+static uint32_t timerCoalesce( uint32_t nominal, uint16_t slack );
+static uint32_t timerRemaining( osalTimerRec_t *tmr );
+static osalTimerHandle_t timerHandle( osalTimerRec_t *tmr );
+static osalTimerRec_t *timerFromHandle( osalTimerHandle_t handle );
+static uint8_t timerIsrPost( uint8_t op, uint8_t task_id, uint16_t event_flag, uint32_t timeout );
+static void timerCbackQueue( osalTimerRec_t *tmr );
+
 /*********************************************************************
  * FUNCTIONS
  *********************************************************************/
@@ -85,6 +227,294 @@ void osalDeleteTimer( osalTimerRec_t *rmTimer );
 void osalTimerInit( void )
 {
   osal_systemClock = 0;
+  osal_systemClockHi = 0;
+  timerWheelNow = 0;
+  timerCbackHead = NULL;
+  timerCbackTail = &timerCbackHead;
+
+  osal_slab_init( &timerSlab, "timer", timerPool, OSAL_SLAB_OBJ_SIZE( osalTimerRec_t ),
+                  OSAL_TIMERS_MAX, 0 );
+}
+
+/*********************************************************************
+ * @fn      timerWheelSlot
+ *
+ * @brief   Select the wheel slot for an expiration time - the slot at
+ *          the level of the highest bit group that still has to elapse.
+ *          Ints must be disabled.
+ *
+ * @param   expire - expiration time after the wheel time
+ *
+ * @return  index of the slot in timerWheel[]
+ */
+static uint8_t timerWheelSlot( uint32_t expire )
+{
+  uint32_t diff = expire ^ timerWheelNow;
+  uint8_t lvl = 0;
+
+  while ( (diff >>= OSAL_TIMER_WHEEL_BITS) != 0 )
+  {
+    lvl++;
+  }
+
+  return ( (uint8_t)(lvl * TIMER_WHEEL_SLOTS) + TIMER_WHEEL_SLOT( lvl, expire ) );
+}
+
+/*********************************************************************
+ * @fn      timerWheelInsert
+ *
+ * @brief   Link a timer into the wheel slot of its expiration time.
+ *          Ints must be disabled.
+ *
+ * @param   tmr - timer with the expiration time set
+ *
+ * @return  none
+ */
+static void timerWheelInsert( osalTimerRec_t *tmr )
+{
+  uint8_t lvl;
+  uint8_t slot;
+
+  tmr->slot = timerWheelSlot( tmr->expire );
+  lvl = tmr->slot / TIMER_WHEEL_SLOTS;
+  slot = tmr->slot & TIMER_WHEEL_MASK;
+
+  tmr->next = timerWheel[tmr->slot];
+  if ( tmr->next != NULL )
+  {
+    tmr->next->pprev = &tmr->next;
+  }
+  tmr->pprev = &timerWheel[tmr->slot];
+  timerWheel[tmr->slot] = tmr;
+
+  timerWheelMap[lvl] |= (uint32_t)1 << slot;
+  if ( !(tmr->flags & OSAL_TIMER_DEFERRABLE) )
+  {
+    timerWheelWakeMap[lvl] |= (uint32_t)1 << slot;
+  }
+}
+
+/*********************************************************************
+ * @fn      timerWheelRemove
+ *
+ * @brief   Unlink a timer from its wheel slot.
+ *          Ints must be disabled.
+ *
+ * @param   tmr - timer in the wheel
+ *
+ * @return  none
+ */
+static void timerWheelRemove( osalTimerRec_t *tmr )
+{
+  osalTimerRec_t *srchTimer;
+  uint32_t mask = ~((uint32_t)1 << (tmr->slot & TIMER_WHEEL_MASK));
+
+  *tmr->pprev = tmr->next;
+  if ( tmr->next != NULL )
+  {
+    tmr->next->pprev = tmr->pprev;
+  }
+
+  if ( timerWheel[tmr->slot] == NULL )
+  {
+    timerWheelMap[tmr->slot / TIMER_WHEEL_SLOTS] &= mask;
+  }
+
+  if ( !(tmr->flags & OSAL_TIMER_DEFERRABLE) )
+  {
+    // Keep the wake bit while another timer of the slot needs it
+    srchTimer = timerWheel[tmr->slot];
+    while ( (srchTimer != NULL) && (srchTimer->flags & OSAL_TIMER_DEFERRABLE) )
+    {
+      srchTimer = srchTimer->next;
+    }
+
+    if ( srchTimer == NULL )
+    {
+      timerWheelWakeMap[tmr->slot / TIMER_WHEEL_SLOTS] &= mask;
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      timerWheelNext
+ *
+ * @brief   Find the next wheel slot to process. Every level below the
+ *          returned one is empty, so no timer expires before the start
+ *          time of that slot. A level 0 slot holds only timers expiring
+ *          exactly at its start time.
+ *          Ints must be disabled.
+ *
+ * @param   wheelMap - slot bitmaps to search, timerWheelMap or
+ *                     timerWheelWakeMap
+ * @param   next - receives the start time of the slot
+ *
+ * @return  level of the slot, TIMER_WHEEL_LEVELS if the wheel is empty
+ */
+static uint8_t timerWheelNext( const uint32_t *wheelMap, uint32_t *next )
+{
+  uint8_t lvl;
+  uint8_t cur;
+  uint8_t ahead;
+  uint32_t map;
+
+  for ( lvl = 0; lvl < TIMER_WHEEL_LEVELS; lvl++ )
+  {
+    map = wheelMap[lvl];
+    if ( map != 0 )
+    {
+      // Rotate the current slot to bit 0 and count the slots ahead of it
+      cur = TIMER_WHEEL_SLOT( lvl, timerWheelNow );
+      map = ((map >> cur) | (map << (TIMER_WHEEL_SLOTS - cur))) & (((uint32_t)1 << TIMER_WHEEL_SLOTS) - 1);
+
+      for ( ahead = 0; (map & 1) == 0; ahead++ )
+      {
+        map >>= 1;
+      }
+
+      *next = ((timerWheelNow >> (lvl * OSAL_TIMER_WHEEL_BITS)) + ahead) << (lvl * OSAL_TIMER_WHEEL_BITS);
+      break;
+    }
+  }
+
+  return ( lvl );
+}
+
+/*********************************************************************
+ * @fn      timerCoalesce
+ *
+ * @brief   Choose an expiration time within the slack window of a
+ *          timer. A wakeup that is already due within the window is
+ *          joined - the wheel slots of both ends of the window are
+ *          searched for it. Otherwise the coarsest power-of-two boundary
+ *          of the wheel time within the window is taken, so that timers
+ *          armed later find each other.
+ *          Ints must be disabled.
+ *
+ * @param   nominal - nominal expiration time
+ * @param   slack - allowed delay, in ms
+ *
+ * @return  expiration time
+ */
+static uint32_t timerCoalesce( uint32_t nominal, uint16_t slack )
+{
+  osalTimerRec_t *srchTimer;
+  uint32_t latest = nominal + slack;
+  uint32_t expire = nominal;
+  uint32_t unit;
+  uint8_t found = FALSE;
+  uint8_t slot;
+
+  // Join the latest wakeup already due within the window
+  slot = timerWheelSlot( nominal );
+  for ( ;; )
+  {
+    for ( srchTimer = timerWheel[slot]; srchTimer != NULL; srchTimer = srchTimer->next )
+    {
+      if ( !(srchTimer->flags & OSAL_TIMER_DEFERRABLE) &&
+           OSAL_TIME_AFTER_EQ( srchTimer->expire, expire ) &&
+           OSAL_TIME_BEFORE_EQ( srchTimer->expire, latest ) )
+      {
+        expire = srchTimer->expire;
+        found = TRUE;
+      }
+    }
+
+    if ( slot == timerWheelSlot( latest ) )
+    {
+      break;
+    }
+    slot = timerWheelSlot( latest );
+  }
+
+  if ( found )
+  {
+    return ( expire );
+  }
+
+  for ( unit = (uint32_t)1 << 16; unit > 1; unit >>= 1 )
+  {
+    if ( OSAL_TIME_AFTER_EQ( latest & ~(unit - 1), nominal ) )
+    {
+      break;
+    }
+  }
+
+  return ( latest & ~(unit - 1) );
+}
+
+/*********************************************************************
+ * @fn      timerArm
+ *
+ * @brief   Set the expiration time of a timer and link it into the
+ *          wheel, delayed within its slack by timerCoalesce().
+ *          Ints must be disabled.
+ *
+ * @param   tmr - timer that is not in the wheel
+ * @param   timeout - time to the nominal expiration, 0 acts like 1
+ *
+ * @return  none
+ */
+static void timerArm( osalTimerRec_t *tmr, uint32_t timeout )
+{
+  uint32_t nominal = timerWheelNow + ((timeout != 0) ? timeout : 1);
+
+  tmr->expire = (tmr->slack != 0) ? timerCoalesce( nominal, tmr->slack ) : nominal;
+  tmr->delay = (uint16_t)(tmr->expire - nominal);
+
+  timerWheelInsert( tmr );
+}
+
+/*********************************************************************
+ * @fn      timerReload
+ *
+ * @brief   Re-arm an expired reload timer one period after its nominal
+ *          expiration, so that it stays phase-locked to its start time.
+ *          The periods that have already passed by 'target' are skipped
+ *          and counted as overruns, they would only set the same event
+ *          again within this update.
+ *          Ints must be disabled.
+ *
+ * @param   tmr - expired timer that is not in the wheel
+ * @param   target - wheel time the running update advances to
+ *
+ * @return  none
+ */
+static void timerReload( osalTimerRec_t *tmr, uint32_t target )
+{
+  uint32_t nominal = tmr->expire - tmr->delay + tmr->reloadTimeout;
+  uint32_t missed;
+
+  if ( OSAL_TIME_AFTER_EQ( target, nominal ) )
+  {
+    missed = (target - nominal) / tmr->reloadTimeout + 1;
+    nominal += missed * tmr->reloadTimeout;
+
+    tmr->overrun = (missed < (uint32_t)(0xFFFF - tmr->overrun)) ?
+                   (uint16_t)(tmr->overrun + missed) : 0xFFFF;
+  }
+
+  timerArm( tmr, nominal - timerWheelNow );
+}
+
+/*********************************************************************
+ * @fn      timerRemaining
+ *
+ * @brief   Time left until a timer expires, from the current tick rather
+ *          than from the wheel time. A timer that is already due but not
+ *          yet expired by osalTickProcess() reports 1.
+ *          Ints must be disabled.
+ *
+ * @param   tmr - timer in the wheel
+ *
+ * @return  milliseconds to the expiration, at least 1
+ */
+static uint32_t timerRemaining( osalTimerRec_t *tmr )
+{
+  uint32_t left = tmr->expire - timerWheelNow;
+  uint32_t lag = osalTickLag();
+
+  return ( (left > lag) ? (left - lag) : 1 );
 }
 
 /*********************************************************************
@@ -102,49 +532,39 @@ void osalTimerInit( void )
 osalTimerRec_t * osalAddTimer( uint8_t task_id, uint16_t event_flag, uint32_t timeout )
 {
   osalTimerRec_t *newTimer;
-  osalTimerRec_t *srchTimer;
 
   // Look for an existing timer first
   newTimer = osalFindTimer( task_id, event_flag );
   if ( newTimer )
   {
-    // Timer is found - update it.
-    newTimer->timeout.time32 = timeout;
+    // Timer is found - move it to its new slot.
+    timerWheelRemove( newTimer );
+    timerArm( newTimer, timeout );
+    newTimer->overrun = 0;
 
     return ( newTimer );
   }
   else
   {
     // New Timer
-    newTimer = osal_mem_alloc( sizeof( osalTimerRec_t ) );
+    newTimer = osal_slab_alloc( &timerSlab );
 
     if ( newTimer )
     {
       // Fill in new timer
       newTimer->task_id = task_id;
       newTimer->event_flag = event_flag;
-      newTimer->timeout.time32 = timeout;
-      newTimer->next = (void *)NULL;
       newTimer->reloadTimeout = 0;
+      newTimer->slack = 0;
+      newTimer->flags = 0;
+      newTimer->overrun = 0;
 
-      // Does the timer list already exist
-      if ( timerHead == NULL )
-      {
-        // Start task list
-        timerHead = newTimer;
-      }
-      else
-      {
-        // Add it to the end of the timer list
-        srchTimer = timerHead;
-
-        // Stop at the last record
-        while ( srchTimer->next )
-          srchTimer = srchTimer->next;
+      timerArm( newTimer, timeout );
+      timerCnt++;
 
-        // Add to the list
-        srchTimer->next = newTimer;
-      }
+      // Index it by (task, event)
+      newTimer->hnext = timerHash[TIMER_HASH( task_id, event_flag )];
+      timerHash[TIMER_HASH( task_id, event_flag )] = newTimer;
 
       return ( newTimer );
     }
@@ -158,7 +578,7 @@ osalTimerRec_t * osalAddTimer( uint8_t task_id, uint16_t event_flag, uint32_t ti
 /*********************************************************************
  * @fn      osalFindTimer
  *
- * @brief   Find a timer in a timer list.
+ * @brief   Find a timer in the (task, event) index.
  *          Ints must be disabled.
  *
  * @param   task_id
@@ -170,8 +590,8 @@ osalTimerRec_t *osalFindTimer( uint8_t task_id, uint16_t event_flag )
 {
   osalTimerRec_t *srchTimer;
 
-  // Head of the timer list
-  srchTimer = timerHead;
+  // Head of the hash bucket
+  srchTimer = timerHash[TIMER_HASH( task_id, event_flag )];
 
   // Stop when found or at the end
   while ( srchTimer )
@@ -183,7 +603,7 @@ osalTimerRec_t *osalFindTimer( uint8_t task_id, uint16_t event_flag )
     }
 
     // Not this one, check another
-    srchTimer = srchTimer->next;
+    srchTimer = srchTimer->hnext;
   }
 
   return ( srchTimer );
@@ -192,22 +612,91 @@ osalTimerRec_t *osalFindTimer( uint8_t task_id, uint16_t event_flag )
 /*********************************************************************
  * @fn      osalDeleteTimer
  *
- * @brief   Delete a timer from a timer list.
+ * @brief   Take a timer out of the timing wheel and the (task, event)
+ *          index, and invalidate its handle. The caller returns the
+ *          record to the timer slab, unless it is a callback timer
+ *          still queued for dispatch.
+ *          Ints must be disabled.
  *
- * @param   table
  * @param   rmTimer
  *
  * @return  none
  */
 void osalDeleteTimer( osalTimerRec_t *rmTimer )
 {
-  // Does the timer list really exist
+  osalTimerRec_t **link;
+
+  // Does the timer really exist
   if ( rmTimer )
   {
-    // Clear the event flag and osalTimerUpdate() will delete
-    // the timer from the list.
-    rmTimer->event_flag = 0;
+    // An expired callback timer has already left the wheel
+    if ( rmTimer->pprev != NULL )
+    {
+      timerWheelRemove( rmTimer );
+      timerCnt--;
+    }
+
+    if ( !(rmTimer->flags & TIMER_CBACK) )
+    {
+      link = &timerHash[TIMER_HASH( rmTimer->task_id, rmTimer->event_flag )];
+      while ( *link != rmTimer )
+      {
+        link = &(*link)->hnext;
+      }
+      *link = rmTimer->hnext;
+    }
+
+    rmTimer->pprev = NULL;
+    rmTimer->gen++;
+  }
+}
+
+/*********************************************************************
+ * @fn      timerHandle
+ *
+ * @brief   Build the handle of a timer.
+ *
+ * @param   tmr - active timer
+ *
+ * @return  handle of the timer
+ */
+static osalTimerHandle_t timerHandle( osalTimerRec_t *tmr )
+{
+  uint32_t offset = (uint32_t)((uint8_t *)tmr - (uint8_t *)timerPool);
+
+  return ( ((uint32_t)tmr->gen << 16) | (offset / TIMER_REC_SIZE + 1) );
+}
+
+/*********************************************************************
+ * @fn      timerFromHandle
+ *
+ * @brief   Look up the timer of a handle, active or an expired callback
+ *          timer waiting for dispatch.
+ *          Ints must be disabled.
+ *
+ * @param   handle - timer handle
+ *
+ * @return  the timer, NULL if the handle is stale or invalid
+ */
+static osalTimerRec_t *timerFromHandle( osalTimerHandle_t handle )
+{
+  osalTimerRec_t *tmr;
+  uint16_t idx = (uint16_t)handle;
+
+  if ( (idx == 0) || (idx > OSAL_TIMERS_MAX) )
+  {
+    return ( NULL );
+  }
+
+  tmr = (osalTimerRec_t *)((uint8_t *)timerPool + (uint32_t)(idx - 1) * TIMER_REC_SIZE);
+
+  if ( (tmr->gen != (uint16_t)(handle >> 16)) ||
+       ((tmr->pprev == NULL) && !(tmr->flags & TIMER_CBACK_PENDING)) )
+  {
+    return ( NULL );
   }
+
+  return ( tmr );
 }
 
 /*********************************************************************
@@ -232,7 +721,7 @@ uint8_t osal_start_timerEx( uint8_t taskID, uint16_t event_id, uint32_t timeout_
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
 
   // Add timer
-  newTimer = osalAddTimer( taskID, event_id, timeout_value );
+  newTimer = osalAddTimer( taskID, event_id, TIMER_TASK_TIMEOUT( timeout_value ) );
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
@@ -262,7 +751,7 @@ uint8_t osal_start_reload_timer( uint8_t taskID, uint16_t event_id, uint32_t tim
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
 
   // Add timer
-  newTimer = osalAddTimer( taskID, event_id, timeout_value );
+  newTimer = osalAddTimer( taskID, event_id, TIMER_TASK_TIMEOUT( timeout_value ) );
   if ( newTimer )
   {
     // Load the reload timeout value
@@ -304,6 +793,11 @@ uint8_t osal_stop_timerEx( uint8_t task_id, uint16_t event_id )
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
+  if ( foundTimer )
+  {
+    osal_slab_free( &timerSlab, foundTimer );
+  }
+
   return ( (foundTimer != NULL) ? OSAL_SUCCESS : INVALID_EVENT_ID );
 }
 
@@ -329,7 +823,7 @@ uint32_t osal_get_timeoutEx( uint8_t task_id, uint16_t event_id )
 
   if ( tmr )
   {
-    rtrn = tmr->timeout.time32;
+    rtrn = timerRemaining( tmr );
   }
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
@@ -338,158 +832,814 @@ uint32_t osal_get_timeoutEx( uint8_t task_id, uint16_t event_id )
 }
 
 /*********************************************************************
- * @fn      osal_timer_num_active
+ * @fn      osal_start_timer_slack
  *
  * @brief
  *
- *   This function counts the number of active timers.
+ *   Start a timer like osal_start_timerEx() that may expire up to
+ *   'slack' mSecs late. The engine uses the slack to expire it together
+ *   with other timers. A deferrable timer does not wake the device from
+ *   power saving sleep, it expires at the first wakeup after its time.
+ *   Restarting the timer keeps its slack and options.
+ *
+ * @param   uint8_t taskID - task id to set timer for
+ * @param   uint16_t event_id - event to be notified with
+ * @param   uint32_t timeout_value - in milliseconds.
+ * @param   uint16_t slack - allowed delay, in milliseconds.
+ * @param   uint8_t flags - OSAL_TIMER_DEFERRABLE or 0
  *
- * @return  uint8_t - number of timers
+ * @return  OSAL_SUCCESS, or NO_TIMER_AVAIL.
  */
-uint8_t osal_timer_num_active( void )
+uint8_t osal_start_timer_slack( uint8_t taskID, uint16_t event_id, uint32_t timeout_value,
+                                uint16_t slack, uint8_t flags )
 {
   halIntState_t intState;
-  uint8_t num_timers = 0;
-  osalTimerRec_t *srchTimer;
+  osalTimerRec_t *newTimer;
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
 
-  // Head of the timer list
-  srchTimer = timerHead;
-
-  // Count timers in the list
-  while ( srchTimer != NULL )
+  // Add timer, then re-arm it with the new slack and options
+  newTimer = osalAddTimer( taskID, event_id, timeout_value );
+  if ( newTimer )
   {
-    num_timers++;
-    srchTimer = srchTimer->next;
+    timerWheelRemove( newTimer );
+    newTimer->slack = slack;
+    newTimer->flags = flags;
+    timerArm( newTimer, TIMER_TASK_TIMEOUT( timeout_value ) );
   }
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-  return num_timers;
+  return ( (newTimer != NULL) ? OSAL_SUCCESS : NO_TIMER_AVAIL );
 }
 
 /*********************************************************************
- * @fn      osalTimerUpdate
+ * @fn      osal_start_reload_timer_slack
  *
- * @brief   Update the timer structures for a timer tick.
+ * @brief
  *
- * @param   none
+ *   Start a reload timer like osal_start_reload_timer() with slack and
+ *   options, see osal_start_timer_slack(). The slack never accumulates,
+ *   each period is measured from the nominal expiration.
  *
- * @return  none
- *********************************************************************/
-void osalTimerUpdate( uint32_t updateTime )
+ * @param   uint8_t taskID - task id to set timer for
+ * @param   uint16_t event_id - event to be notified with
+ * @param   uint32_t timeout_value - in milliseconds.
+ * @param   uint16_t slack - allowed delay, in milliseconds.
+ * @param   uint8_t flags - OSAL_TIMER_DEFERRABLE or 0
+ *
+ * @return  OSAL_SUCCESS, or NO_TIMER_AVAIL.
+ */
+uint8_t osal_start_reload_timer_slack( uint8_t taskID, uint16_t event_id, uint32_t timeout_value,
+                                       uint16_t slack, uint8_t flags )
 {
   halIntState_t intState;
-  osalTimerRec_t *srchTimer;
-  osalTimerRec_t *prevTimer;
-
-  osalTime_t timeUnion;
-  timeUnion.time32 = updateTime;
+  osalTimerRec_t *newTimer;
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
-  // Update the system time
-  osal_systemClock += updateTime;
-  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-  // Look for open timer slot
-  if ( timerHead != NULL )
+  // Add timer, then re-arm it with the new slack and options
+  newTimer = osalAddTimer( taskID, event_id, timeout_value );
+  if ( newTimer )
   {
-    // Add it to the end of the timer list
-    srchTimer = timerHead;
-    prevTimer = (void *)NULL;
+    timerWheelRemove( newTimer );
+    newTimer->slack = slack;
+    newTimer->flags = flags;
+    timerArm( newTimer, TIMER_TASK_TIMEOUT( timeout_value ) );
 
-    // Look for open timer slot
-    while ( srchTimer )
-    {
-      osalTimerRec_t *freeTimer = NULL;
+    // Load the reload timeout value
+    newTimer->reloadTimeout = timeout_value;
+  }
 
-      HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-      // To minimize time in this critical section, avoid 32-bit math
-      if ((timeUnion.time16[1] == 0) && (timeUnion.time8[1] == 0))
-      {
-        // If upper 24 bits are zero, check lower 8 bits for roll over
-        if (srchTimer->timeout.time8[0] >= timeUnion.time8[0])
-        {
-          // 8-bit math
-          srchTimer->timeout.time8[0] -= timeUnion.time8[0];
-        }
-        else
-        {
-          // 32-bit math
-          if (srchTimer->timeout.time32 > timeUnion.time32)
-          {
-            srchTimer->timeout.time32 -= timeUnion.time32;
-          }
-          else
-          {
-            srchTimer->timeout.time32 = 0;
-          }
-        }
+  return ( (newTimer != NULL) ? OSAL_SUCCESS : NO_TIMER_AVAIL );
+}
+
+/*********************************************************************
+ * @fn      osal_start_timer_handle
+ *
+ * @brief
+ *
+ *   Start a timer like osal_start_timerEx() and return its handle for
+ *   the constant-time handle functions.
+ *
+ * @param   uint8_t taskID - task id to set timer for
+ * @param   uint16_t event_id - event to be notified with
+ * @param   uint32_t timeout_value - in milliseconds.
+ * @param   osalTimerHandle_t *handle - receives the handle of the timer,
+ *          OSAL_TIMER_NO_HANDLE if no timer is available
+ *
+ * @return  OSAL_SUCCESS, or NO_TIMER_AVAIL.
+ */
+uint8_t osal_start_timer_handle( uint8_t taskID, uint16_t event_id, uint32_t timeout_value,
+                                 osalTimerHandle_t *handle )
+{
+  halIntState_t intState;
+  osalTimerRec_t *newTimer;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  // Add timer
+  newTimer = osalAddTimer( taskID, event_id, TIMER_TASK_TIMEOUT( timeout_value ) );
+  *handle = (newTimer != NULL) ? timerHandle( newTimer ) : OSAL_TIMER_NO_HANDLE;
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( (newTimer != NULL) ? OSAL_SUCCESS : NO_TIMER_AVAIL );
+}
+
+/*********************************************************************
+ * @fn      osal_start_reload_timer_handle
+ *
+ * @brief
+ *
+ *   Start a reload timer like osal_start_reload_timer() and return its
+ *   handle for the constant-time handle functions.
+ *
+ * @param   uint8_t taskID - task id to set timer for
+ * @param   uint16_t event_id - event to be notified with
+ * @param   uint32_t timeout_value - in milliseconds.
+ * @param   osalTimerHandle_t *handle - receives the handle of the timer,
+ *          OSAL_TIMER_NO_HANDLE if no timer is available
+ *
+ * @return  OSAL_SUCCESS, or NO_TIMER_AVAIL.
+ */
+uint8_t osal_start_reload_timer_handle( uint8_t taskID, uint16_t event_id, uint32_t timeout_value,
+                                        osalTimerHandle_t *handle )
+{
+  halIntState_t intState;
+  osalTimerRec_t *newTimer;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  // Add timer
+  newTimer = osalAddTimer( taskID, event_id, TIMER_TASK_TIMEOUT( timeout_value ) );
+  if ( newTimer )
+  {
+    // Load the reload timeout value
+    newTimer->reloadTimeout = timeout_value;
+  }
+  *handle = (newTimer != NULL) ? timerHandle( newTimer ) : OSAL_TIMER_NO_HANDLE;
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( (newTimer != NULL) ? OSAL_SUCCESS : NO_TIMER_AVAIL );
+}
+
+/*********************************************************************
+ * @fn      osal_restart_timer_handle
+ *
+ * @brief
+ *
+ *   Restart an active timer with a new timeout. A reload timer keeps
+ *   its reload value, the slack and options are kept as well.
+ *
+ * @param   osalTimerHandle_t handle - handle of the timer
+ * @param   uint32_t timeout_value - in milliseconds.
+ *
+ * @return  OSAL_SUCCESS or INVALID_EVENT_ID if the handle is stale
+ */
+uint8_t osal_restart_timer_handle( osalTimerHandle_t handle, uint32_t timeout_value )
+{
+  halIntState_t intState;
+  osalTimerRec_t *tmr;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  tmr = timerFromHandle( handle );
+
+  // An expired callback timer is only waiting for its callback
+  if ( (tmr != NULL) && (tmr->pprev == NULL) )
+  {
+    tmr = NULL;
+  }
+
+  if ( tmr )
+  {
+    timerWheelRemove( tmr );
+    timerArm( tmr, TIMER_TASK_TIMEOUT( timeout_value ) );
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( (tmr != NULL) ? OSAL_SUCCESS : INVALID_EVENT_ID );
+}
+
+/*********************************************************************
+ * @fn      osal_stop_timer_handle
+ *
+ * @brief
+ *
+ *   Stop an active timer, its event will not be set. A callback timer
+ *   can also be stopped after it expired as long as its callback has
+ *   not been dispatched, the callback is then not called.
+ *
+ * @param   osalTimerHandle_t handle - handle of the timer
+ *
+ * @return  OSAL_SUCCESS or INVALID_EVENT_ID if the handle is stale
+ */
+uint8_t osal_stop_timer_handle( osalTimerHandle_t handle )
+{
+  halIntState_t intState;
+  osalTimerRec_t *foundTimer;
+  uint8_t rtrn = INVALID_EVENT_ID;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  foundTimer = timerFromHandle( handle );
+  if ( foundTimer )
+  {
+    osalDeleteTimer( foundTimer );
+    rtrn = OSAL_SUCCESS;
+
+    // A queued callback timer is freed by its dispatch
+    if ( foundTimer->flags & TIMER_CBACK_PENDING )
+    {
+      foundTimer->pfnCback = NULL;
+      foundTimer = NULL;
+    }
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  if ( foundTimer )
+  {
+    osal_slab_free( &timerSlab, foundTimer );
+  }
+
+  return ( rtrn );
+}
+
+/*********************************************************************
+ * @fn      osal_get_timeout_handle
+ *
+ * @brief
+ *
+ * @param   osalTimerHandle_t handle - handle of the timer
+ *
+ * @return  Return the timer's tick count if active, zero otherwise.
+ */
+uint32_t osal_get_timeout_handle( osalTimerHandle_t handle )
+{
+  halIntState_t intState;
+  uint32_t rtrn = 0;
+  osalTimerRec_t *tmr;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  tmr = timerFromHandle( handle );
+  if ( (tmr != NULL) && (tmr->pprev != NULL) )
+  {
+    rtrn = timerRemaining( tmr );
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return rtrn;
+}
+
+/*********************************************************************
+ * @fn      osal_get_timer_overrun
+ *
+ * @brief
+ *
+ *   Read and clear the overrun count of a reload timer - the number of
+ *   periods that expired while the event of an earlier period was still
+ *   pending, or that passed within one long timer update. Called by the
+ *   task when it processes the timer event, the count tells how many
+ *   periods the event stands for besides the first one.
+ *
+ * @param   uint8_t task_id - task id of timer to check
+ * @param   uint16_t event_id - identifier of timer to be checked
+ *
+ * @return  Number of missed periods, zero if the timer is not found.
+ */
+uint16_t osal_get_timer_overrun( uint8_t task_id, uint16_t event_id )
+{
+  halIntState_t intState;
+  uint16_t rtrn = 0;
+  osalTimerRec_t *tmr;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  tmr = osalFindTimer( task_id, event_id );
+  if ( tmr )
+  {
+    rtrn = tmr->overrun;
+    tmr->overrun = 0;
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return rtrn;
+}
+
+/*********************************************************************
+ * @fn      osal_get_timer_overrun_handle
+ *
+ * @brief
+ *
+ *   Read and clear the overrun count of a reload timer by handle, see
+ *   osal_get_timer_overrun().
+ *
+ * @param   osalTimerHandle_t handle - handle of the timer
+ *
+ * @return  Number of missed periods, zero if the handle is stale.
+ */
+uint16_t osal_get_timer_overrun_handle( osalTimerHandle_t handle )
+{
+  halIntState_t intState;
+  uint16_t rtrn = 0;
+  osalTimerRec_t *tmr;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  tmr = timerFromHandle( handle );
+  if ( tmr )
+  {
+    rtrn = tmr->overrun;
+    tmr->overrun = 0;
+  }
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return rtrn;
+}
+
+/*********************************************************************
+ * @fn      timerIsrPost
+ *
+ * @brief   Queue a timer command for the OSAL loop. Interrupts are only
+ *          held off to claim the entry.
+ *
+ * @param   op - TIMER_ISR_xxx command
+ * @param   task_id
+ * @param   event_flag
+ * @param   timeout - timeout from now, in mSecs
+ *
+ * @return  OSAL_SUCCESS, or NO_TIMER_AVAIL if the queue is full
+ */
+static uint8_t timerIsrPost( uint8_t op, uint8_t task_id, uint16_t event_flag, uint32_t timeout )
+{
+  halIntState_t intState;
+  timerIsrCmd_t *cmd;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  if ( (uint8_t)(timerIsrHead - timerIsrTail) >= OSAL_TIMER_ISR_QUEUE )
+  {
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+    return ( NO_TIMER_AVAIL );
+  }
+  cmd = &timerIsrQueue[timerIsrHead & (OSAL_TIMER_ISR_QUEUE - 1)];
+  timerIsrHead++;
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  cmd->tick = osalTickCount();
+  cmd->timeout = timeout;
+  cmd->event_flag = event_flag;
+  cmd->task_id = task_id;
+  cmd->op = op;
+
+  return ( OSAL_SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      osal_start_timer_isr
+ *
+ * @brief
+ *
+ *   Start a timer like osal_start_timerEx() from an interrupt. The
+ *   command is queued and applied by the OSAL loop, the timeout counts
+ *   from the tick at which it was queued.
+ *
+ * @param   uint8_t taskID - task id to set timer for
+ * @param   uint16_t event_id - event to be notified with
+ * @param   uint32_t timeout_value - in milliseconds.
+ *
+ * @return  OSAL_SUCCESS, or NO_TIMER_AVAIL if the command queue is full.
+ */
+uint8_t osal_start_timer_isr( uint8_t taskID, uint16_t event_id, uint32_t timeout_value )
+{
+  return ( timerIsrPost( TIMER_ISR_START, taskID, event_id, timeout_value ) );
+}
+
+/*********************************************************************
+ * @fn      osal_start_reload_timer_isr
+ *
+ * @brief
+ *
+ *   Start a reload timer like osal_start_reload_timer() from an
+ *   interrupt, see osal_start_timer_isr().
+ *
+ * @param   uint8_t taskID - task id to set timer for
+ * @param   uint16_t event_id - event to be notified with
+ * @param   uint32_t timeout_value - in milliseconds.
+ *
+ * @return  OSAL_SUCCESS, or NO_TIMER_AVAIL if the command queue is full.
+ */
+uint8_t osal_start_reload_timer_isr( uint8_t taskID, uint16_t event_id, uint32_t timeout_value )
+{
+  return ( timerIsrPost( TIMER_ISR_RELOAD, taskID, event_id, timeout_value ) );
+}
+
+/*********************************************************************
+ * @fn      osal_stop_timer_isr
+ *
+ * @brief
+ *
+ *   Stop a timer like osal_stop_timerEx() from an interrupt. The
+ *   command is queued and applied by the OSAL loop.
+ *
+ * @param   uint8_t task_id - task id of timer to stop
+ * @param   uint16_t event_id - identifier of the timer that is to be stopped
+ *
+ * @return  OSAL_SUCCESS, or NO_TIMER_AVAIL if the command queue is full.
+ */
+uint8_t osal_stop_timer_isr( uint8_t task_id, uint16_t event_id )
+{
+  return ( timerIsrPost( TIMER_ISR_STOP, task_id, event_id, 0 ) );
+}
+
+/*********************************************************************
+ * @fn      osalTimerDrainIsr
+ *
+ * @brief
+ *
+ *   Apply the timer commands queued from interrupts. Called from the
+ *   OSAL loop while the wheel time matches tick count 'tickDone'.
+ *
+ * @param   uint32_t tickDone - tick count the wheel has been advanced to
+ *
+ * @return  none
+ */
+void osalTimerDrainIsr( uint32_t tickDone )
+{
+  timerIsrCmd_t *cmd;
+  int32_t timeout;
+
+  while ( timerIsrTail != timerIsrHead )
+  {
+    cmd = &timerIsrQueue[timerIsrTail & (OSAL_TIMER_ISR_QUEUE - 1)];
+    if ( cmd->op == 0 )
+    {
+      break;  // Claimed but not written yet
+    }
+
+    // Count the timeout from the tick it was queued at
+    timeout = OSAL_TIME_DIFF( cmd->tick + cmd->timeout, tickDone );
+    if ( timeout < 0 )
+    {
+      timeout = 0;
+    }
+
+    if ( cmd->op == TIMER_ISR_STOP )
+    {
+      (void)osal_stop_timerEx( cmd->task_id, cmd->event_flag );
+    }
+    else
+    {
+      halIntState_t intState;
+      osalTimerRec_t *newTimer;
+
+      // Armed against the wheel time directly, the timeout is already counted
+      // from 'tickDone'. Only the first expiration of a reload timer is
+      // shortened, the period stays as posted.
+      HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+      newTimer = osalAddTimer( cmd->task_id, cmd->event_flag, (uint32_t)timeout );
+      if ( newTimer && (cmd->op == TIMER_ISR_RELOAD) )
+      {
+        newTimer->reloadTimeout = cmd->timeout;
       }
-      else
+      HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+    }
+
+    cmd->op = 0;
+    timerIsrTail++;
+  }
+}
+
+/*********************************************************************
+ * @fn      timerCbackQueue
+ *
+ * @brief   Queue an expired callback timer for dispatch and notify the
+ *          dispatching task. A reload timer still queued from its
+ *          previous period counts an overrun instead.
+ *          Ints must be disabled.
+ *
+ * @param   tmr - expired callback timer
+ *
+ * @return  none
+ */
+static void timerCbackQueue( osalTimerRec_t *tmr )
+{
+  if ( tmr->flags & TIMER_CBACK_PENDING )
+  {
+    if ( tmr->overrun != 0xFFFF )
+    {
+      tmr->overrun++;
+    }
+    return;
+  }
+
+  tmr->flags |= TIMER_CBACK_PENDING;
+  tmr->hnext = NULL;
+  *timerCbackTail = tmr;
+  timerCbackTail = &tmr->hnext;
+
+  osal_set_event( timerCbackTask, timerCbackEvent );
+}
+
+/*********************************************************************
+ * @fn      osalTimerCbackInit
+ *
+ * @brief
+ *
+ *   Register the task event that dispatches expired callback timers,
+ *   see osalTimerCbackNext().
+ *
+ * @param   uint8_t task_id - dispatching task
+ * @param   uint16_t event_id - event set when a callback is due
+ *
+ * @return  none
+ */
+void osalTimerCbackInit( uint8_t task_id, uint16_t event_id )
+{
+  timerCbackTask = task_id;
+  timerCbackEvent = event_id;
+}
+
+/*********************************************************************
+ * @fn      osal_start_cback_timer
+ *
+ * @brief
+ *
+ *   Start a callback timer. Callback timers take their record from the
+ *   timer pool like event timers but are not bound to a (task, event),
+ *   they are only reached through their handle. On expiration the
+ *   callback is queued for the task registered with
+ *   osalTimerCbackInit().
+ *
+ * @param   pfnTimerCback_t pfnCback - callback function
+ * @param   uint8_t *pData - data passed to the callback
+ * @param   uint32_t timeout_value - in milliseconds.
+ * @param   uint8_t reload - TRUE to reload the timer with the same timeout
+ * @param   osalTimerHandle_t *handle - receives the handle of the timer,
+ *          OSAL_TIMER_NO_HANDLE if no timer is available
+ *
+ * @return  OSAL_SUCCESS, INVALIDPARAMETER or NO_TIMER_AVAIL.
+ */
+uint8_t osal_start_cback_timer( pfnTimerCback_t pfnCback, uint8_t *pData, uint32_t timeout_value,
+                                uint8_t reload, osalTimerHandle_t *handle )
+{
+  halIntState_t intState;
+  osalTimerRec_t *newTimer;
+
+  *handle = OSAL_TIMER_NO_HANDLE;
+
+  if ( pfnCback == NULL )
+  {
+    return ( INVALIDPARAMETER );
+  }
+
+  newTimer = osal_slab_alloc( &timerSlab );
+  if ( newTimer == NULL )
+  {
+    return ( NO_TIMER_AVAIL );
+  }
+
+  newTimer->task_id = timerCbackTask;
+  newTimer->event_flag = timerCbackEvent;
+  newTimer->reloadTimeout = reload ? timeout_value : 0;
+  newTimer->slack = 0;
+  newTimer->flags = TIMER_CBACK;
+  newTimer->overrun = 0;
+  newTimer->pfnCback = pfnCback;
+  newTimer->pData = pData;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+  timerArm( newTimer, TIMER_TASK_TIMEOUT( timeout_value ) );
+  timerCnt++;
+  *handle = timerHandle( newTimer );
+
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  return ( OSAL_SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      osalTimerCbackNext
+ *
+ * @brief
+ *
+ *   Take the oldest expired callback timer off the dispatch queue. The
+ *   record of a one-shot timer goes back to the pool, so its handle is
+ *   stale by the time the callback runs. Stopped timers are skipped.
+ *   Interrupts are only held off to unlink the record, the caller runs
+ *   the callback with them enabled.
+ *
+ * @param   pfnTimerCback_t *pfnCback - receives the callback function
+ * @param   uint8_t **pData - receives the data passed to the callback
+ *
+ * @return  TRUE if a callback is due, FALSE if the queue is empty
+ */
+uint8_t osalTimerCbackNext( pfnTimerCback_t *pfnCback, uint8_t **pData )
+{
+  halIntState_t intState;
+  osalTimerRec_t *tmr;
+  osalTimerRec_t *freeTimer;
+
+  do
+  {
+    freeTimer = NULL;
+
+    HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+    tmr = timerCbackHead;
+    if ( tmr != NULL )
+    {
+      timerCbackHead = tmr->hnext;
+      if ( timerCbackHead == NULL )
       {
-          // 32-bit math
-        if (srchTimer->timeout.time32 > timeUnion.time32)
-        {
-          srchTimer->timeout.time32 -= timeUnion.time32;
-        }
-        else
+        timerCbackTail = &timerCbackHead;
+      }
+      tmr->flags &= ~TIMER_CBACK_PENDING;
+
+      *pfnCback = tmr->pfnCback;
+      *pData = tmr->pData;
+
+      // A one-shot timer is done, a stopped one is already invalidated
+      if ( tmr->pprev == NULL )
+      {
+        if ( tmr->pfnCback != NULL )
         {
-          srchTimer->timeout.time32 = 0;
+          tmr->gen++;
         }
+        freeTimer = tmr;
       }
+    }
 
-      // Check for reloading
-      if ( (srchTimer->timeout.time16[0] == 0) && (srchTimer->timeout.time16[1] == 0) &&
-           (srchTimer->reloadTimeout) && (srchTimer->event_flag) )
-      {
-        // Notify the task of a timeout
-        osal_set_event( srchTimer->task_id, srchTimer->event_flag );
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-        // Reload the timer timeout value
-        srchTimer->timeout.time32 = srchTimer->reloadTimeout;
-      }
+    if ( freeTimer )
+    {
+      osal_slab_free( &timerSlab, freeTimer );
+    }
+  } while ( (tmr != NULL) && (*pfnCback == NULL) );
+
+  return ( (tmr != NULL) ? TRUE : FALSE );
+}
+
+/*********************************************************************
+ * @fn      osal_timer_num_active
+ *
+ * @brief
+ *
+ *   This function counts the number of active timers.
+ *
+ * @return  uint16_t - number of timers
+ */
+uint16_t osal_timer_num_active( void )
+{
+  return ( timerCnt );
+}
 
-      // When timeout or delete (event_flag == 0)
-      if ( ((srchTimer->timeout.time16[0] == 0) && (srchTimer->timeout.time16[1] == 0)) ||
-            (srchTimer->event_flag == 0) )
+/*********************************************************************
+ * @fn      osal_timer_high_water
+ *
+ * @brief
+ *
+ *   This function returns the highest number of timers that were active
+ *   at the same time, to size OSAL_TIMERS_MAX.
+ *
+ * @return  uint16_t - high-water mark of the timer pool
+ */
+uint16_t osal_timer_high_water( void )
+{
+  osalSlabStats_t stats;
+
+  osal_slab_stats( &timerSlab, &stats );
+
+  return ( stats.maxUsed );
+}
+
+/*********************************************************************
+ * @fn      osalTimerUpdate
+ *
+ * @brief   Update the timer structures for a timer tick. Only the wheel
+ *          slots due within the elapsed time are visited, an expired
+ *          timer is taken out of the wheel with interrupts disabled and
+ *          its task notified after they are re-enabled.
+ *
+ * @param   none
+ *
+ * @return  none
+ *********************************************************************/
+void osalTimerUpdate( uint32_t updateTime )
+{
+  halIntState_t intState;
+  osalTimerRec_t *srchTimer;
+  osalTimerRec_t *freeTimer;
+  uint32_t target;
+  uint32_t next;
+  uint8_t lvl;
+  uint8_t slot;
+
+  HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+  // Update the system time
+  osal_systemClock += updateTime;
+  if ( osal_systemClock < updateTime )
+  {
+    osal_systemClockHi++;
+  }
+  target = timerWheelNow + updateTime;
+  HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+  for ( ;; )
+  {
+    HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+    // Advance the wheel to the next non-empty slot or to the target time
+    lvl = timerWheelNext( timerWheelMap, &next );
+    if ( (lvl == TIMER_WHEEL_LEVELS) || OSAL_TIME_AFTER( next, target ) )
+    {
+      timerWheelNow = target;
+      HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+      break;
+    }
+
+    timerWheelNow = next;
+    slot = (uint8_t)(lvl * TIMER_WHEEL_SLOTS) + TIMER_WHEEL_SLOT( lvl, next );
+
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+
+    // The slot is now the current one and receives no new timers, expire
+    // its timers or cascade them to the lower levels.
+    do
+    {
+      freeTimer = NULL;
+
+      HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
+
+      srchTimer = timerWheel[slot];
+      if ( srchTimer != NULL )
       {
-        // Take out of list
-        if ( prevTimer == NULL )
+        if ( srchTimer->expire != timerWheelNow )
+        {
+          timerWheelRemove( srchTimer );
+          timerWheelInsert( srchTimer );
+        }
+        else if ( srchTimer->reloadTimeout )
+        {
+          if ( srchTimer->flags & TIMER_CBACK )
+          {
+            timerCbackQueue( srchTimer );
+          }
+          else
+          {
+            // A period whose event the task has not processed yet is lost
+            if ( (srchTimer->task_id < tasksCnt) &&
+                 (tasksEvents[srchTimer->task_id] & srchTimer->event_flag) &&
+                 (srchTimer->overrun != 0xFFFF) )
+            {
+              srchTimer->overrun++;
+            }
+
+            // Notify the task of a timeout
+            osal_set_event( srchTimer->task_id, srchTimer->event_flag );
+          }
+
+          // Reload the timer timeout value, from the nominal expiration
+          timerWheelRemove( srchTimer );
+          timerReload( srchTimer, target );
+        }
+        else if ( srchTimer->flags & TIMER_CBACK )
         {
-          timerHead = srchTimer->next;
+          // Keep the record and its handle until the callback is dispatched
+          timerWheelRemove( srchTimer );
+          srchTimer->pprev = NULL;
+          timerCnt--;
+          timerCbackQueue( srchTimer );
         }
         else
         {
-          prevTimer->next = srchTimer->next;
+          // Setup to free memory
+          osalDeleteTimer( srchTimer );
+          freeTimer = srchTimer;
         }
-
-        // Setup to free memory
-        freeTimer = srchTimer;
-
-        // Next
-        srchTimer = srchTimer->next;
-      }
-      else
-      {
-        // Get next
-        prevTimer = srchTimer;
-        srchTimer = srchTimer->next;
       }
 
       HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
       if ( freeTimer )
       {
-        if ( (freeTimer->timeout.time16[0] == 0) && (freeTimer->timeout.time16[1] == 0) )
-        {
-          osal_set_event( freeTimer->task_id, freeTimer->event_flag );
-        }
-        osal_mem_free( freeTimer );
+        osal_set_event( freeTimer->task_id, freeTimer->event_flag );
+        osal_slab_free( &timerSlab, freeTimer );
       }
-    }
+    } while ( srchTimer != NULL );
   }
 }
 
@@ -536,7 +1686,7 @@ void osal_adjust_timers( void )
 {
   uint32_t eTime;
 
-  if ( timerHead != NULL )
+  if ( timerCnt != 0 )
   {
     // Compute elapsed time (msec)
     eTime = TimerElapsed() / TICK_COUNT;
@@ -555,8 +1705,11 @@ void osal_adjust_timers( void )
  *
  * @brief
  *
- *   Search timer table to return the lowest timeout value. If the
- *   timer list is empty, then the returned timeout will be zero.
+ *   Return the lowest timeout value of the timing wheel. If no timer
+ *   is active, then the returned timeout will be zero. Only the first
+ *   wheel slot holding a timer that is not deferrable is examined,
+ *   deferrable timers never shorten the sleep.
+ *   Ints must be disabled.
  *
  * @param   none
  *
@@ -565,30 +1718,35 @@ void osal_adjust_timers( void )
 uint32_t osal_next_timeout( void )
 {
   uint32_t nextTimeout;
+  uint32_t next;
+  uint8_t lvl;
   osalTimerRec_t *srchTimer;
 
-  if ( timerHead != NULL )
+  // Deferrable timers do not wake the device
+  lvl = timerWheelNext( timerWheelWakeMap, &next );
+  if ( lvl == TIMER_WHEEL_LEVELS )
   {
-    // Head of the timer list
-    srchTimer = timerHead;
-    nextTimeout = OSAL_TIMERS_MAX_TIMEOUT;
+    // No timers
+    return ( 0 );
+  }
+
+  nextTimeout = next - timerWheelNow;
 
-    // Look for the next timeout timer
+  if ( lvl != 0 )
+  {
+    // Timers above level 0 may expire anywhere in their slot
+    nextTimeout = OSAL_TIMERS_MAX_TIMEOUT;
+    srchTimer = timerWheel[lvl * TIMER_WHEEL_SLOTS + TIMER_WHEEL_SLOT( lvl, next )];
     while ( srchTimer != NULL )
     {
-      if (srchTimer->timeout.time32 < nextTimeout)
+      if ( !(srchTimer->flags & OSAL_TIMER_DEFERRABLE) &&
+           ((srchTimer->expire - timerWheelNow) < nextTimeout) )
       {
-        nextTimeout = srchTimer->timeout.time32;
+        nextTimeout = srchTimer->expire - timerWheelNow;
       }
-      // Check next timer
       srchTimer = srchTimer->next;
     }
   }
-  else
-  {
-    // No timers
-    nextTimeout = 0;
-  }
 
   return ( nextTimeout );
 }
@@ -605,7 +1763,32 @@ uint32_t osal_next_timeout( void )
  */
 uint32_t osal_GetSystemClock( void )
 {
-  return ( osal_systemClock );
+  return ( osal_systemClock + osalTickLag() );
+}
+
+/*********************************************************************
+ * @fn      osal_GetSystemClock64()
+ *
+ * @brief   Read the local system clock as a 64-bit count that does not
+ *          wrap. The high word is read again after the low word, the
+ *          read is repeated if an update carried into it meanwhile.
+ *
+ * @param   none
+ *
+ * @return  local clock in milliseconds
+ */
+uint64_t osal_GetSystemClock64( void )
+{
+  uint32_t hi;
+  uint32_t lo;
+
+  do
+  {
+    hi = osal_systemClockHi;
+    lo = osal_systemClock;
+  } while ( hi != osal_systemClockHi );
+
+  return ( (((uint64_t)hi << 32) | lo) + osalTickLag() );
 }
 
 /*********************************************************************
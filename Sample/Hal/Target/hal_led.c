@@ -282,7 +282,7 @@ void HalLedUpdate (void)
         if (sts->mode & HAL_LED_MODE_BLINK)
         {
           time = osal_GetSystemClock();
-          if (time >= sts->next)
+          if (OSAL_TIME_AFTER_EQ(time, sts->next))  /* Wrap-safe */
           {
             if (sts->mode & HAL_LED_MODE_ON)
             {